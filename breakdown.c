@@ -0,0 +1,97 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Latency breakdown of IOs. The run queue delay comes from
+ * /proc/thread-self/schedstat, whose second field is the time the thread
+ * has spent runnable but waiting for a CPU; it needs CONFIG_SCHED_INFO
+ * and is read before and after every IO, which costs a system call each.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "breakdown.h"
+
+void breakdown_init(struct lat_breakdown *b)
+{
+	lat_hist_init(&b->submit);
+	lat_hist_init(&b->device);
+	lat_hist_init(&b->reap);
+	lat_hist_init(&b->runq);
+}
+
+void breakdown_merge(struct lat_breakdown *dst,
+		const struct lat_breakdown *src)
+{
+	lat_hist_merge(&dst->submit, &src->submit);
+	lat_hist_merge(&dst->device, &src->device);
+	lat_hist_merge(&dst->reap, &src->reap);
+	lat_hist_merge(&dst->runq, &src->runq);
+}
+
+void breakdown_print(const struct lat_breakdown *b)
+{
+	if (b->submit.count)
+		lat_hist_print("submit", &b->submit);
+	if (b->device.count)
+		lat_hist_print("device", &b->device);
+	if (b->reap.count)
+		lat_hist_print("reap", &b->reap);
+	if (b->runq.count)
+		lat_hist_print("runq", &b->runq);
+}
+
+int schedstat_open(void)
+{
+	int fd;
+
+	fd = open("/proc/thread-self/schedstat", O_RDONLY);
+	if (fd < 0)
+		fprintf(stderr, "No schedstat, run queue delay not sampled: "
+				"%s\n", strerror(errno));
+	return fd;
+}
+
+unsigned long long schedstat_run_delay(int fd)
+{
+	unsigned long long	run, delay;
+	char			buf[128];
+	ssize_t			n;
+
+	n = pread(fd, buf, sizeof(buf) - 1, 0);
+	if (n <= 0)
+		return 0;
+	buf[n] = 0;
+
+	/* on cpu ns, run queue ns, timeslices */
+	if (sscanf(buf, "%llu %llu", &run, &delay) != 2)
+		return 0;
+	return delay;
+}
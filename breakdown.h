@@ -0,0 +1,56 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __BREAKDOWN_H__
+#define __BREAKDOWN_H__
+
+#include "stats.h"
+
+/*
+ * Where the latency of an IO went. Queued engines split it into the time
+ * spent in the submit call, the time until the engine saw the completion
+ * and the time until the worker accounted it; synchronous engines only
+ * have the device part. runq is the time the worker spent waiting for a
+ * CPU while the IO was in flight, from the run_delay of schedstat.
+ */
+struct lat_breakdown {
+	struct lat_hist		submit;
+	struct lat_hist		device;
+	struct lat_hist		reap;
+	struct lat_hist		runq;
+};
+
+void breakdown_init(struct lat_breakdown *b);
+
+void breakdown_merge(struct lat_breakdown *dst,
+		const struct lat_breakdown *src);
+
+void breakdown_print(const struct lat_breakdown *b);
+
+/* schedstat of the calling thread, -1 if the kernel has no schedstats */
+int schedstat_open(void);
+
+/* ns the thread waited on a run queue so far, 0 on error */
+unsigned long long schedstat_run_delay(int fd);
+
+#endif
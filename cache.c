@@ -0,0 +1,234 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Page cache control and observation for buffered IO: fadvise hints,
+ * dropping a file's cached pages before a run, and the page cache hit
+ * ratio of reads. The hit ratio is sampled: before one in every few reads
+ * the worker asks mincore() whether the block is resident, through a
+ * mapping of its range that is never touched itself.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "iob.h"
+#include "target.h"
+#include "cache.h"
+
+#ifndef __NR_cachestat
+#define __NR_cachestat	451
+#endif
+
+struct cachestat_range {
+	unsigned long long	off;
+	unsigned long long	len;
+};
+
+struct cachestat {
+	unsigned long long	nr_cache;
+	unsigned long long	nr_dirty;
+	unsigned long long	nr_writeback;
+	unsigned long long	nr_evicted;
+	unsigned long long	nr_recently_evicted;
+};
+
+int parse_fadvise(const char *str, int *advice)
+{
+	if (!strcmp(str, "normal"))
+		*advice = POSIX_FADV_NORMAL;
+	else if (!strcmp(str, "sequential"))
+		*advice = POSIX_FADV_SEQUENTIAL;
+	else if (!strcmp(str, "random"))
+		*advice = POSIX_FADV_RANDOM;
+	else if (!strcmp(str, "willneed"))
+		*advice = POSIX_FADV_WILLNEED;
+	else if (!strcmp(str, "dontneed"))
+		*advice = POSIX_FADV_DONTNEED;
+	else if (!strcmp(str, "noreuse"))
+		*advice = POSIX_FADV_NOREUSE;
+	else
+		return -1;
+	return 0;
+}
+
+int cache_advise(int fd, unsigned long long offset, unsigned long long length,
+		int advice)
+{
+	int rc;
+
+	/* returns the error instead of setting errno */
+	rc = posix_fadvise(fd, offset, length, advice);
+	if (rc) {
+		fprintf(stderr, "posix_fadvise failed: %s\n", strerror(rc));
+		return -1;
+	}
+	return 0;
+}
+
+/* dirty pages are written first, only clean pages can be dropped */
+int cache_drop(const char *path)
+{
+	int	fd;
+	int	rc;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "open(%s) failed: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	if (fdatasync(fd) < 0) {
+		fprintf(stderr, "fdatasync(%s) failed: %s\n", path,
+				strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	rc = cache_advise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+	return rc;
+}
+
+/* leaves cs invalid when the kernel has no cachestat() */
+void cache_state(const char *path, unsigned long long length,
+		struct cache_state *cs)
+{
+	struct cachestat_range	range = { 0, length };
+	struct cachestat	st;
+	int			fd;
+
+	memset(cs, 0, sizeof(*cs));
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return;
+
+	if (!syscall(__NR_cachestat, fd, &range, &st, 0)) {
+		cs->valid   = 1;
+		cs->cached  = st.nr_cache;
+		cs->dirty   = st.nr_dirty;
+		cs->evicted = st.nr_evicted;
+	}
+	close(fd);
+}
+
+int cache_probe_open(struct cache_probe *cp, int fd, unsigned long long offset,
+		unsigned long long length)
+{
+	unsigned long long start;
+
+	memset(cp, 0, sizeof(*cp));
+	cp->page   = sysconf(_SC_PAGESIZE);
+	start      = offset - offset % cp->page;
+	cp->offset = start;
+	cp->length = length + (offset - start);
+
+	cp->map = mmap(NULL, cp->length, PROT_READ, MAP_SHARED, fd, start);
+	if (cp->map == MAP_FAILED) {
+		cp->map = NULL;
+		fprintf(stderr, "mmap for page cache sampling failed: %s\n",
+				strerror(errno));
+		return -1;
+	}
+
+	cp->vec = malloc(cp->length / cp->page + 2);
+	if (!cp->vec) {
+		cache_probe_close(cp);
+		return -1;
+	}
+	return 0;
+}
+
+/* 1 if every page of the range is cached, 0 if not, -1 on error */
+int cache_probe_resident(struct cache_probe *cp, unsigned long long offset,
+		unsigned long length)
+{
+	unsigned long long	start;
+	unsigned long		pages;
+	unsigned long		i;
+
+	start  = offset - offset % cp->page;
+	length = length + (offset - start);
+	pages  = (length + cp->page - 1) / cp->page;
+
+	if (mincore(cp->map + (start - cp->offset), pages * cp->page,
+				cp->vec) < 0)
+		return -1;
+
+	for (i = 0; i < pages; i++)
+		if (!(cp->vec[i] & 1))
+			return 0;
+	return 1;
+}
+
+void cache_probe_close(struct cache_probe *cp)
+{
+	if (cp->map)
+		munmap(cp->map, cp->length);
+	free(cp->vec);
+	cp->map = NULL;
+	cp->vec = NULL;
+}
+
+void cache_report(struct run *r, FILE *fp)
+{
+	struct result_data	*rd;
+	struct cache_state	*s, *e;
+	struct job		*job;
+	unsigned long long	samples, hits;
+	int			i, j;
+
+	rd = r->results;
+	for (j = 0; j < r->no_jobs; j++) {
+		job     = &r->jobs[j];
+		samples = hits = 0;
+		for (i = 0; i < job->procs; i++, rd++) {
+			samples += rd->cache_samples;
+			hits    += rd->cache_hits;
+		}
+
+		s = r->cache ? &r->cache[2 * j] : NULL;
+		e = r->cache ? &r->cache[2 * j + 1] : NULL;
+		if (!samples && !(s && s->valid && e->valid))
+			continue;
+
+		fprintf(fp, "\nPage cache = %s\n", job->name);
+		if (samples)
+			fprintf(fp, "Read hit ratio = %.1f%% (%llu of %llu "
+					"sampled reads)\n", 100.0 * hits / samples,
+					hits, samples);
+		if (s && s->valid && e->valid)
+			fprintf(fp, "Cached pages = %llu at start, %llu at end, "
+					"%llu dirty, %llu evicted during the run\n",
+					s->cached, e->cached, e->dirty,
+					e->evicted - s->evicted);
+	}
+}
@@ -0,0 +1,70 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include <stdio.h>
+
+struct run;
+
+#define CACHE_SAMPLE_DEFAULT	16	/* one in this many reads */
+
+/* tells whether a range of a file is in the page cache, see mincore(2) */
+struct cache_probe {
+	char			*map;		/* never accessed */
+	unsigned long long	offset;
+	unsigned long long	length;
+	long			page;
+	unsigned char		*vec;
+};
+
+/* page cache state of a range, from cachestat(2) */
+struct cache_state {
+	int			valid;
+	unsigned long long	cached;		/* pages */
+	unsigned long long	dirty;
+	unsigned long long	evicted;
+};
+
+int parse_fadvise(const char *str, int *advice);
+
+int cache_advise(int fd, unsigned long long offset, unsigned long long length,
+		int advice);
+
+int cache_drop(const char *path);
+
+void cache_state(const char *path, unsigned long long length,
+		struct cache_state *cs);
+
+int cache_probe_open(struct cache_probe *cp, int fd, unsigned long long offset,
+		unsigned long long length);
+
+int cache_probe_resident(struct cache_probe *cp, unsigned long long offset,
+		unsigned long length);
+
+void cache_probe_close(struct cache_probe *cp);
+
+void cache_report(struct run *r, FILE *fp);
+
+#endif
@@ -0,0 +1,362 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Block layer statistics of the devices under the jobs, read from sysfs
+ * when the workers start, while they run and once they are done. They
+ * tell how much of the latency seen by iob is spent in the device and how
+ * much queueing and merging the kernel did on the way.
+ *
+ * Jobs on a regular file are accounted to the device holding the file
+ * system, if it has one.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include "iob.h"
+#include "diskstats.h"
+#include "target.h"
+
+static int sysfs_read(const char *dir, const char *file, char *buf, int len)
+{
+	char	path[PATH_MAX];
+	FILE	*fp;
+	char	*nl;
+
+	if (snprintf(path, sizeof(path), "%s/%s", dir, file) >=
+			(int) sizeof(path))
+		return -1;
+	fp = fopen(path, "r");
+	if (!fp)
+		return -1;
+
+	if (!fgets(buf, len, fp)) {
+		fclose(fp);
+		return -1;
+	}
+	fclose(fp);
+
+	nl = strchr(buf, '\n');
+	if (nl)
+		*nl = 0;
+	return 0;
+}
+
+static void disk_queue(struct disk *d)
+{
+	char	dir[PATH_MAX];
+	char	buf[256];
+	char	*s, *e;
+
+	/* partitions share the queue of the whole disk */
+	strcpy(d->scheduler, "none");
+	if (snprintf(dir, sizeof(dir), "%s/%s/queue", d->dir,
+			sysfs_read(d->dir, "partition", buf, sizeof(buf)) ?
+			"." : "..") >= (int) sizeof(dir))
+		return;
+
+	if (!sysfs_read(dir, "nr_requests", buf, sizeof(buf)))
+		d->nr_requests = strtoul(buf, NULL, 10);
+	if (!sysfs_read(dir, "max_sectors_kb", buf, sizeof(buf)))
+		d->max_sectors_kb = strtoul(buf, NULL, 10);
+	if (!sysfs_read(dir, "rotational", buf, sizeof(buf)))
+		d->rotational = atoi(buf);
+
+	/* the active scheduler is the one in brackets */
+	if (!sysfs_read(dir, "scheduler", buf, sizeof(buf))) {
+		s = strchr(buf, '[');
+		e = s ? strchr(s, ']') : NULL;
+		if (e) {
+			*e = 0;
+			snprintf(d->scheduler, sizeof(d->scheduler), "%s", s + 1);
+		}
+	}
+}
+
+static int disk_sample(struct disk *d, struct disk_sample *s)
+{
+	char	buf[512];
+	char	*p, *e;
+	int	i;
+
+	memset(s, 0, sizeof(*s));
+	s->ns = get_hrtime(CLOCK_MONOTONIC);
+	if (sysfs_read(d->dir, "stat", buf, sizeof(buf)) < 0)
+		return -1;
+
+	p = buf;
+	for (i = 0; i < DS_FIELDS; i++) {
+		s->v[i] = strtoull(p, &e, 10);
+		if (e == p)
+			return -1;
+		p = e;
+	}
+
+	d->max_inflight = MAX(d->max_inflight, s->v[DS_IN_FLIGHT]);
+	return 0;
+}
+
+/* sysfs directory of the block device backing path */
+static int disk_lookup(const char *path, dev_t *dev, char *dir)
+{
+	struct stat	buf;
+	char		link[64];
+
+	if (stat(path, &buf) < 0)
+		return -1;
+
+	*dev = S_ISBLK(buf.st_mode) ? buf.st_rdev : buf.st_dev;
+	snprintf(link, sizeof(link), "/sys/dev/block/%u:%u", major(*dev),
+			minor(*dev));
+
+	/* not there for tmpfs, overlayfs and other virtual file systems */
+	if (!realpath(link, dir) || access(dir, R_OK) < 0)
+		return -1;
+	return 0;
+}
+
+/* whole disk under path, the device io.max and friends take */
+int disk_whole(const char *path, dev_t *dev)
+{
+	char		dir[PATH_MAX];
+	char		parent[PATH_MAX];
+	char		buf[64];
+	unsigned int	maj, min;
+
+	if (disk_lookup(path, dev, dir) < 0)
+		return -1;
+
+	if (sysfs_read(dir, "partition", buf, sizeof(buf)) < 0)
+		return 0;
+
+	if (snprintf(parent, sizeof(parent), "%s/..", dir) >=
+			(int) sizeof(parent))
+		return -1;
+	if (sysfs_read(parent, "dev", buf, sizeof(buf)) < 0 ||
+			sscanf(buf, "%u:%u", &maj, &min) != 2)
+		return -1;
+
+	*dev = makedev(maj, min);
+	return 0;
+}
+
+struct diskstats *diskstats_open(struct run *r, unsigned long long interval)
+{
+	struct diskstats	*ds;
+	struct disk		*d;
+	char			dir[PATH_MAX];
+	char			path[PATH_MAX];
+	dev_t			dev;
+	int			width;
+	int			i, j, m;
+
+	ds = calloc(1, sizeof(*ds));
+	if (!ds)
+		return NULL;
+
+	for (j = 0; j < r->no_jobs; j++)
+		ds->max_disks += job_stripe_width(&r->jobs[j]);
+
+	ds->interval = interval;
+	ds->disks    = calloc(ds->max_disks, sizeof(*ds->disks));
+	ds->job_disk = calloc(r->no_jobs, sizeof(*ds->job_disk));
+	if (!ds->disks || !ds->job_disk) {
+		diskstats_close(ds);
+		return NULL;
+	}
+
+	for (j = 0; j < r->no_jobs; j++) {
+		width = job_stripe_width(&r->jobs[j]);
+		ds->job_disk[j] = -1;
+
+		/* members of a stripe are sampled, iob IOs are not split up */
+		for (m = 0; m < width; m++) {
+			if (job_stripe_path(&r->jobs[j], m, path, sizeof(path)) < 0 ||
+					disk_lookup(path, &dev, dir) < 0)
+				continue;
+
+			for (i = 0; i < ds->no_disks; i++)
+				if (ds->disks[i].dev == dev)
+					break;
+			if (width == 1)
+				ds->job_disk[j] = i;
+			if (i < ds->no_disks)
+				continue;
+			if (ds->no_disks == ds->max_disks)
+				break;
+
+			d = &ds->disks[ds->no_disks++];
+			d->dev = dev;
+			snprintf(d->dir, sizeof(d->dir), "%s", dir);
+			snprintf(d->name, sizeof(d->name), "%s",
+					strrchr(dir, '/') + 1);
+			disk_queue(d);
+		}
+	}
+	return ds;
+}
+
+void diskstats_close(struct diskstats *ds)
+{
+	if (!ds)
+		return;
+	free(ds->disks);
+	free(ds->job_disk);
+	free(ds);
+}
+
+void diskstats_start(struct diskstats *ds)
+{
+	struct disk	*d;
+	int		i;
+
+	for (i = 0; i < ds->no_disks; i++) {
+		d = &ds->disks[i];
+		d->max_inflight = 0;
+		disk_sample(d, &d->start);
+		d->last = d->start;
+	}
+	ds->next = get_hrtime(CLOCK_MONOTONIC) + ds->interval;
+}
+
+static void disk_print(FILE *fp, struct disk *d, struct disk_sample *a,
+		struct disk_sample *b)
+{
+	unsigned long long	ios, ticks;
+	double			ms;
+
+	ms = (double) (b->ns - a->ns) / (SEC_TO_NS / SEC_TO_MILLI);
+	if (ms <= 0)
+		return;
+
+	ios   = b->v[DS_READ_IOS] - a->v[DS_READ_IOS] +
+		b->v[DS_WRITE_IOS] - a->v[DS_WRITE_IOS];
+	ticks = b->v[DS_READ_TICKS] - a->v[DS_READ_TICKS] +
+		b->v[DS_WRITE_TICKS] - a->v[DS_WRITE_TICKS];
+
+	fprintf(fp, "%s: IOPS = %.0f (r %.0f, w %.0f), MB/s = %.2f, "
+			"merges r %llu w %llu, queue depth = %.2f, util = %.1f%%, "
+			"await = %.3f ms, svctm = %.3f ms\n", d->name,
+			ios * 1000 / ms,
+			(b->v[DS_READ_IOS] - a->v[DS_READ_IOS]) * 1000 / ms,
+			(b->v[DS_WRITE_IOS] - a->v[DS_WRITE_IOS]) * 1000 / ms,
+			(double) (b->v[DS_READ_SECTORS] - a->v[DS_READ_SECTORS] +
+				b->v[DS_WRITE_SECTORS] - a->v[DS_WRITE_SECTORS]) *
+				512 * 1000 / ms / (1024 * 1024),
+			b->v[DS_READ_MERGES] - a->v[DS_READ_MERGES],
+			b->v[DS_WRITE_MERGES] - a->v[DS_WRITE_MERGES],
+			(b->v[DS_TIME_IN_QUEUE] - a->v[DS_TIME_IN_QUEUE]) / ms,
+			MIN(100.0, (b->v[DS_IO_TICKS] - a->v[DS_IO_TICKS]) * 100 / ms),
+			ios ? (double) ticks / ios : 0,
+			ios ? (double) (b->v[DS_IO_TICKS] - a->v[DS_IO_TICKS]) /
+				ios : 0);
+}
+
+/* called from the run loop, prints deltas once per interval */
+void diskstats_poll(struct diskstats *ds, FILE *fp)
+{
+	struct disk_sample	s;
+	struct disk		*d;
+	int			print;
+	int			i;
+
+	print = ds->interval && get_hrtime(CLOCK_MONOTONIC) >= ds->next;
+	for (i = 0; i < ds->no_disks; i++) {
+		d = &ds->disks[i];
+		if (disk_sample(d, &s) < 0 || !print)
+			continue;
+
+		disk_print(fp, d, &d->last, &s);
+		d->last = s;
+	}
+
+	if (print) {
+		ds->next += ds->interval;
+		fflush(fp);
+	}
+}
+
+void diskstats_stop(struct diskstats *ds)
+{
+	int	i;
+
+	for (i = 0; i < ds->no_disks; i++)
+		disk_sample(&ds->disks[i], &ds->disks[i].end);
+}
+
+void diskstats_report(struct diskstats *ds, struct run *r, FILE *fp)
+{
+	struct result_data	*rd;
+	struct disk		*d;
+	unsigned long long	app_ios, app_lat, app_sectors;
+	unsigned long long	dev_ios, dev_sectors;
+	int			i, j, k;
+
+	for (i = 0; i < ds->no_disks; i++) {
+		d = &ds->disks[i];
+
+		app_ios = app_lat = app_sectors = 0;
+		rd = r->results;
+		for (j = 0; j < r->no_jobs; j++) {
+			for (k = 0; k < r->jobs[j].procs; k++, rd++) {
+				if (ds->job_disk[j] != i)
+					continue;
+				app_ios     += rd->reads + rd->writes;
+				app_lat     += rd->total_read_latency +
+					rd->total_write_latency;
+				app_sectors += (rd->reads + rd->writes) *
+					r->jobs[j].block_size / 512;
+			}
+		}
+
+		dev_ios     = d->end.v[DS_READ_IOS] - d->start.v[DS_READ_IOS] +
+			d->end.v[DS_WRITE_IOS] - d->start.v[DS_WRITE_IOS];
+		dev_sectors = d->end.v[DS_READ_SECTORS] -
+			d->start.v[DS_READ_SECTORS] +
+			d->end.v[DS_WRITE_SECTORS] - d->start.v[DS_WRITE_SECTORS];
+
+		fprintf(fp, "\nDisk = %s (%u:%u), scheduler %s, nr_requests %lu, "
+				"max_sectors_kb %lu, %s\n", d->name, major(d->dev),
+				minor(d->dev), d->scheduler, d->nr_requests,
+				d->max_sectors_kb, d->rotational ? "rotational" :
+				"non-rotational");
+		disk_print(fp, d, &d->start, &d->end);
+		fprintf(fp, "%s: IOs = %llu device, %llu iob; sectors = %llu "
+				"device, %llu iob; peak in flight = %llu\n",
+				d->name, dev_ios, app_ios, dev_sectors,
+				app_sectors, d->max_inflight);
+		if (app_ios)
+			fprintf(fp, "%s: iob avg latency = %.3f ms\n", d->name,
+					(double) app_lat / app_ios /
+					(SEC_TO_NS / SEC_TO_MILLI));
+	}
+}
@@ -0,0 +1,92 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __DISKSTATS_H__
+#define __DISKSTATS_H__
+
+#include <stdio.h>
+#include <limits.h>
+#include <sys/types.h>
+
+struct run;
+
+/* fields of /sys/block/<dev>/stat, see Documentation/block/stat.rst */
+enum {
+	DS_READ_IOS,
+	DS_READ_MERGES,
+	DS_READ_SECTORS,
+	DS_READ_TICKS,		/* ms */
+	DS_WRITE_IOS,
+	DS_WRITE_MERGES,
+	DS_WRITE_SECTORS,
+	DS_WRITE_TICKS,		/* ms */
+	DS_IN_FLIGHT,
+	DS_IO_TICKS,		/* ms the device had IO in flight */
+	DS_TIME_IN_QUEUE,	/* ms, weighted by IOs in flight */
+	DS_FIELDS,
+};
+
+struct disk_sample {
+	unsigned long long	ns;		/* CLOCK_MONOTONIC */
+	unsigned long long	v[DS_FIELDS];
+};
+
+struct disk {
+	char			name[32];	/* DISK_NAME_LEN */
+	char			dir[PATH_MAX];	/* sysfs directory */
+	dev_t			dev;
+
+	/* queue settings */
+	char			scheduler[32];
+	unsigned long		nr_requests;
+	unsigned long		max_sectors_kb;
+	int			rotational;
+
+	struct disk_sample	start, last, end;
+	unsigned long long	max_inflight;	/* peak seen while sampling */
+};
+
+struct diskstats {
+	struct disk		*disks;
+	int			no_disks;
+	int			max_disks;
+	int			*job_disk;	/* disk of each job, -1 if none */
+	unsigned long long	interval;	/* ns, 0: no periodic output */
+	unsigned long long	next;		/* ns of next periodic sample */
+};
+
+int disk_whole(const char *path, dev_t *dev);
+
+struct diskstats *diskstats_open(struct run *r, unsigned long long interval);
+
+void diskstats_close(struct diskstats *ds);
+
+void diskstats_start(struct diskstats *ds);
+
+void diskstats_poll(struct diskstats *ds, FILE *fp);
+
+void diskstats_stop(struct diskstats *ds);
+
+void diskstats_report(struct diskstats *ds, struct run *r, FILE *fp);
+
+#endif
@@ -0,0 +1,576 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Crash consistency checking. Writers of a durability run put
+ * self-describing blocks on the target, see struct dur_block, and append
+ * a record to a journal on another file system for every write their sync
+ * policy considers durable. After the writers were killed or the device
+ * lost its unflushed writes, a checker scans the acknowledged blocks and
+ * counts those that are missing, stale or torn.
+ *
+ * Acks of the none and always policies are journaled in batches, so up to
+ * DUR_ACK_BATCH acknowledged writes of a killed worker go unchecked; the
+ * check never reports a write lost that was not acknowledged.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <pthread.h>
+
+#include "iob.h"
+#include "durability.h"
+
+/* none, always, fsync[:n] or fdatasync[:n] */
+int parse_sync(const char *str, int *policy, unsigned int *every)
+{
+	const char	*n;
+	size_t		len;
+	char		*end;
+
+	n   = strchr(str, ':');
+	len = n ? (size_t) (n - str) : strlen(str);
+
+	*every = 0;
+	if (!strncmp(str, "none", len) && len == 4)
+		*policy = SYNC_NONE;
+	else if (!strncmp(str, "always", len) && len == 6)
+		*policy = SYNC_ALWAYS;
+	else if (!strncmp(str, "fsync", len) && len == 5)
+		*policy = SYNC_FSYNC;
+	else if (!strncmp(str, "fdatasync", len) && len == 9)
+		*policy = SYNC_FDATASYNC;
+	else
+		return -1;
+
+	if (*policy != SYNC_FSYNC && *policy != SYNC_FDATASYNC)
+		return n ? -1 : 0;
+
+	*every = 1;
+	if (n) {
+		*every = strtoul(n + 1, &end, 10);
+		if (*end || !*every)
+			return -1;
+	}
+	return 0;
+}
+
+void sync_name(int policy, unsigned int every, char *buf, size_t len)
+{
+	switch (policy) {
+	case SYNC_NONE:
+		snprintf(buf, len, "none");
+		break;
+	case SYNC_ALWAYS:
+		snprintf(buf, len, "always");
+		break;
+	case SYNC_FSYNC:
+		snprintf(buf, len, "fsync:%u", every);
+		break;
+	case SYNC_FDATASYNC:
+		snprintf(buf, len, "fdatasync:%u", every);
+		break;
+	default:
+		snprintf(buf, len, "default");
+		break;
+	}
+}
+
+static int write_all(int fd, const void *buf, size_t len)
+{
+	const char	*p = buf;
+	ssize_t		rc;
+
+	while (len) {
+		rc = write(fd, p, len);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		p   += rc;
+		len -= rc;
+	}
+	return 0;
+}
+
+int dur_journal_create(struct run *r, const char *path)
+{
+	struct dur_journal_header	h;
+	struct dur_journal_job		jj;
+	struct job			*job;
+	int				fd;
+	int				j;
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "open(%s) failed: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	memset(&h, 0, sizeof(h));
+	h.magic   = DUR_JOURNAL_MAGIC;
+	h.version = DUR_JOURNAL_VERSION;
+	h.no_jobs = r->no_jobs;
+	h.run_id  = get_hrtime(CLOCK_REALTIME) ^ ((uint64_t) getpid() << 40);
+	if (write_all(fd, &h, sizeof(h)) < 0)
+		goto error;
+
+	for (j = 0; j < r->no_jobs; j++) {
+		job = &r->jobs[j];
+		memset(&jj, 0, sizeof(jj));
+		snprintf(jj.name, sizeof(jj.name), "%s", job->name);
+		snprintf(jj.path, sizeof(jj.path), "%s", job->path);
+		sync_name(job->sync_policy, job->sync_every, jj.policy,
+				sizeof(jj.policy));
+		jj.block_size = job->block_size;
+		if (write_all(fd, &jj, sizeof(jj)) < 0)
+			goto error;
+	}
+
+	/* the header must be there before the first ack */
+	if (fsync(fd) < 0)
+		goto error;
+
+	r->run_id = h.run_id;
+	return fd;
+error:
+	fprintf(stderr, "Writing journal %s failed: %s\n", path, strerror(errno));
+	close(fd);
+	return -1;
+}
+
+int dur_writer_init(struct dur_writer *w, int fd, uint64_t run_id,
+		int job, unsigned int every)
+{
+	memset(w, 0, sizeof(*w));
+	w->fd     = fd;
+	w->run_id = run_id;
+	w->job    = job;
+	w->size   = MAX(every, DUR_ACK_BATCH);
+	w->recs   = calloc(w->size, sizeof(*w->recs));
+	if (!w->recs) {
+		fprintf(stderr, "Memory Allocation Failed.\n");
+		return -1;
+	}
+	return 0;
+}
+
+static uint64_t dur_sum(const char *buf, unsigned long size)
+{
+	const uint64_t	*p = (const uint64_t *) buf;
+	uint64_t	h  = DUR_BLOCK_MAGIC;
+	unsigned long	i;
+
+	for (i = 0; i < size / sizeof(*p); i++) {
+		h ^= p[i];
+		h *= 0x100000001b3ULL;
+		h ^= h >> 32;
+	}
+	return h;
+}
+
+void dur_fill(struct dur_writer *w, char *buf, unsigned long size,
+		unsigned long block)
+{
+	struct dur_block	*db = (struct dur_block *) buf;
+	struct dur_sector	*s;
+	unsigned long		i;
+
+	w->seq++;
+	verify_fill(buf, size, w->seq ^ ((uint64_t) block << 24));
+	for (i = 0; i < size; i += DUR_SECTOR) {
+		s = (struct dur_sector *) (buf + i);
+		s->run_id = w->run_id;
+		s->seq    = w->seq;
+	}
+
+	db->magic = DUR_BLOCK_MAGIC;
+	db->block = block;
+	db->sum   = 0;
+	db->sum   = dur_sum(buf, size);
+}
+
+static int dur_flush(struct dur_writer *w)
+{
+	if (!w->no_acked)
+		return 0;
+
+	if (write_all(w->fd, w->recs, w->no_acked * sizeof(*w->recs)) < 0) {
+		fprintf(stderr, "Journal write failed: %s\n", strerror(errno));
+		return -1;
+	}
+
+	memmove(w->recs, w->recs + w->no_acked,
+			(w->no_recs - w->no_acked) * sizeof(*w->recs));
+	w->no_recs -= w->no_acked;
+	w->no_acked = 0;
+	return 0;
+}
+
+int dur_written(struct dur_writer *w, unsigned long block)
+{
+	struct dur_record *rec;
+
+	/* more writes than the sync interval, make room */
+	if (w->no_recs == w->size && dur_flush(w) < 0)
+		return -1;
+	if (w->no_recs == w->size) {
+		fprintf(stderr, "Journal full, %u writes not acknowledged.\n",
+				w->no_recs);
+		return -1;
+	}
+
+	rec        = &w->recs[w->no_recs++];
+	rec->job   = w->job;
+	rec->pad   = 0;
+	rec->block = block;
+	rec->seq   = w->seq;
+	return 0;
+}
+
+int dur_ack(struct dur_writer *w, int force)
+{
+	int n;
+
+	n = w->no_recs - w->no_acked;
+	w->no_acked = w->no_recs;
+	if ((force || w->no_acked >= DUR_ACK_BATCH) && dur_flush(w) < 0)
+		return -1;
+	return n;
+}
+
+int dur_writer_close(struct dur_writer *w)
+{
+	int rc;
+
+	rc = dur_flush(w);
+	free(w->recs);
+	w->recs = NULL;
+	return rc;
+}
+
+/* what the checker knows about one job of the journal */
+struct dur_target {
+	struct dur_journal_job	jj;
+	uint64_t		run_id;
+	int			fd;
+	struct dur_record	*acks;		/* by block, latest seq */
+	unsigned long		no_acks;
+	unsigned long long	records;	/* journaled, before dedup */
+};
+
+enum {
+	DUR_INTACT,
+	DUR_LOST,		/* never landed or an older write is there */
+	DUR_TORN,		/* sectors of different writes */
+	DUR_CORRUPT,		/* one write, but the checksum does not match */
+	DUR_STATES,
+};
+
+static const char *dur_state_names[DUR_STATES] = {
+	"intact", "lost", "torn", "corrupt",
+};
+
+#define DUR_EXAMPLES	8
+
+/* one scanner thread, acks [first, last) of a target */
+struct dur_scan {
+	pthread_t		thread;
+	struct dur_target	*t;
+	unsigned long		first;
+	unsigned long		last;
+	unsigned long long	count[DUR_STATES];
+	unsigned long		examples[DUR_STATES][DUR_EXAMPLES];
+	int			rc;
+};
+
+static int dur_classify(const struct dur_target *t, char *buf,
+		const struct dur_record *ack)
+{
+	struct dur_block	*db = (struct dur_block *) buf;
+	struct dur_sector	*s;
+	unsigned long		size = t->jj.block_size;
+	unsigned long		i, ours;
+	uint64_t		sum;
+
+	ours = 0;
+	for (i = 0; i < size; i += DUR_SECTOR) {
+		s = (struct dur_sector *) (buf + i);
+		if (s->run_id == t->run_id && s->seq == db->s.seq)
+			ours++;
+		else if (s->run_id == t->run_id)
+			return DUR_TORN;
+	}
+
+	if (!ours || db->s.run_id != t->run_id)
+		return ours ? DUR_TORN : DUR_LOST;
+	if (ours != size / DUR_SECTOR)
+		return DUR_TORN;
+
+	sum = db->sum;
+	db->sum = 0;
+	if (db->magic != DUR_BLOCK_MAGIC || db->block != ack->block ||
+			dur_sum(buf, size) != sum)
+		return DUR_CORRUPT;
+
+	/* later writes than the acknowledged one are fine */
+	return db->s.seq < ack->seq ? DUR_LOST : DUR_INTACT;
+}
+
+static void *dur_scan_thread(void *arg)
+{
+	struct dur_scan		*sc = arg;
+	struct dur_target	*t = sc->t;
+	unsigned long		size = t->jj.block_size;
+	unsigned long		max = MAX(DUR_SCAN_BYTES / size, 1);
+	unsigned long		i, n, k;
+	ssize_t			rc;
+	char			*buf;
+	int			st;
+
+	buf = memalign(IO_BLOCK_SIZE, max * size);
+	if (!buf) {
+		sc->rc = -1;
+		return NULL;
+	}
+
+	for (i = sc->first; i < sc->last; i += n) {
+		/* one read for a run of contiguous acknowledged blocks */
+		for (n = 1; i + n < sc->last && n < max &&
+				t->acks[i + n].block == t->acks[i].block + n; n++)
+			;
+
+		rc = pread(t->fd, buf, n * size, (off_t) t->acks[i].block * size);
+		if (rc < 0) {
+			fprintf(stderr, "Reading %s failed: %s\n", t->jj.path,
+					strerror(errno));
+			sc->rc = -1;
+			break;
+		}
+
+		for (k = 0; k < n; k++) {
+			/* beyond the end of a file that lost its tail */
+			if ((k + 1) * size > (unsigned long) rc)
+				st = DUR_LOST;
+			else
+				st = dur_classify(t, buf + k * size, &t->acks[i + k]);
+
+			if (st != DUR_INTACT && sc->count[st] < DUR_EXAMPLES)
+				sc->examples[st][sc->count[st]] = t->acks[i + k].block;
+			sc->count[st]++;
+		}
+	}
+
+	free(buf);
+	return NULL;
+}
+
+static int dur_ack_cmp(const void *a, const void *b)
+{
+	const struct dur_record *x = a, *y = b;
+
+	if (x->block != y->block)
+		return x->block < y->block ? -1 : 1;
+	if (x->seq != y->seq)
+		return x->seq < y->seq ? -1 : 1;
+	return 0;
+}
+
+/* sorts by block and keeps the latest acknowledged write of each */
+static void dur_target_dedup(struct dur_target *t)
+{
+	unsigned long i, n;
+
+	qsort(t->acks, t->no_acks, sizeof(*t->acks), dur_ack_cmp);
+	for (i = 0, n = 0; i < t->no_acks; i++) {
+		if (n && t->acks[n - 1].block == t->acks[i].block)
+			n--;
+		t->acks[n++] = t->acks[i];
+	}
+	t->no_acks = n;
+}
+
+static int dur_check_target(struct dur_target *t, int threads, FILE *out)
+{
+	struct dur_scan		*sc;
+	unsigned long long	count[DUR_STATES];
+	unsigned long		per, e;
+	int			i, st, k, n, rc;
+
+	dur_target_dedup(t);
+
+	fprintf(out, "\nDurability = %s (%s), sync policy %s\n", t->jj.name,
+			t->jj.path, t->jj.policy);
+	fprintf(out, "Acknowledged writes = %llu, blocks = %lu\n", t->records,
+			t->no_acks);
+	if (!t->no_acks)
+		return 0;
+
+	t->fd = open(t->jj.path, O_RDONLY);
+	if (t->fd < 0) {
+		fprintf(stderr, "open(%s) failed: %s\n", t->jj.path,
+				strerror(errno));
+		return -1;
+	}
+
+	threads = MAX(MIN((unsigned long) threads, t->no_acks), 1);
+	sc      = calloc(threads, sizeof(*sc));
+	if (!sc) {
+		fprintf(stderr, "Memory Allocation Failed.\n");
+		close(t->fd);
+		return -1;
+	}
+
+	per = (t->no_acks + threads - 1) / threads;
+	for (i = 0, n = 0; i < threads; i++, n++) {
+		sc[i].t     = t;
+		sc[i].first = MIN(i * per, t->no_acks);
+		sc[i].last  = MIN((i + 1) * per, t->no_acks);
+		if (pthread_create(&sc[i].thread, NULL, dur_scan_thread, &sc[i])) {
+			fprintf(stderr, "Starting scanner failed.\n");
+			sc[i].rc = -1;
+			break;
+		}
+	}
+
+	rc = 0;
+	memset(count, 0, sizeof(count));
+	for (i = 0; i < n; i++) {
+		pthread_join(sc[i].thread, NULL);
+		if (sc[i].rc < 0)
+			rc = -1;
+		for (st = 0; st < DUR_STATES; st++)
+			count[st] += sc[i].count[st];
+	}
+
+	fprintf(out, "Intact = %llu, lost = %llu, torn = %llu, corrupt = %llu\n",
+			count[DUR_INTACT], count[DUR_LOST], count[DUR_TORN],
+			count[DUR_CORRUPT]);
+
+	for (st = DUR_LOST; st < DUR_STATES; st++) {
+		if (!count[st])
+			continue;
+
+		fprintf(out, "%s blocks:", dur_state_names[st]);
+		for (i = 0, k = 0; i < n && k < DUR_EXAMPLES; i++) {
+			for (e = 0; e < MIN(sc[i].count[st], DUR_EXAMPLES) &&
+					k < DUR_EXAMPLES; e++, k++)
+				fprintf(out, " %lu", sc[i].examples[st][e]);
+		}
+		fprintf(out, count[st] > k ? " ...\n" : "\n");
+	}
+
+	free(sc);
+	close(t->fd);
+	if (rc < 0)
+		return -1;
+	return count[DUR_LOST] || count[DUR_TORN] || count[DUR_CORRUPT] ? 1 : 0;
+}
+
+int dur_check(const char *journal, int threads, FILE *out)
+{
+	struct dur_journal_header	h;
+	struct dur_target		*t;
+	struct dur_record		rec, *acks;
+	FILE				*f;
+	int				j, rc, bad;
+
+	f = fopen(journal, "r");
+	if (!f) {
+		fprintf(stderr, "fopen(%s) failed: %s\n", journal, strerror(errno));
+		return -1;
+	}
+
+	if (fread(&h, sizeof(h), 1, f) != 1 || h.magic != DUR_JOURNAL_MAGIC ||
+			h.version != DUR_JOURNAL_VERSION || !h.no_jobs) {
+		fprintf(stderr, "%s is not a durability journal.\n", journal);
+		fclose(f);
+		return -1;
+	}
+
+	t = calloc(h.no_jobs, sizeof(*t));
+	if (!t) {
+		fprintf(stderr, "Memory Allocation Failed.\n");
+		fclose(f);
+		return -1;
+	}
+
+	rc = 0;
+	for (j = 0; j < h.no_jobs; j++) {
+		t[j].run_id = h.run_id;
+		if (fread(&t[j].jj, sizeof(t[j].jj), 1, f) != 1 ||
+				t[j].jj.block_size < sizeof(struct dur_block) ||
+				t[j].jj.block_size % DUR_SECTOR) {
+			fprintf(stderr, "%s: bad job entry.\n", journal);
+			rc = -1;
+			goto out;
+		}
+		t[j].jj.name[sizeof(t[j].jj.name) - 1]     = 0;
+		t[j].jj.path[sizeof(t[j].jj.path) - 1]     = 0;
+		t[j].jj.policy[sizeof(t[j].jj.policy) - 1] = 0;
+	}
+
+	/* a torn record at the end was never acknowledged */
+	while (fread(&rec, sizeof(rec), 1, f) == 1) {
+		if (rec.job >= h.no_jobs)
+			continue;
+
+		/* room for twice as many at 0, 1, 3, 7, ... records */
+		j = rec.job;
+		if (!(t[j].no_acks & (t[j].no_acks + 1))) {
+			acks = realloc(t[j].acks, (t[j].no_acks + 1) * 2 *
+					sizeof(*acks));
+			if (!acks) {
+				fprintf(stderr, "Memory Allocation Failed.\n");
+				rc = -1;
+				goto out;
+			}
+			t[j].acks = acks;
+		}
+		t[j].acks[t[j].no_acks++] = rec;
+		t[j].records++;
+	}
+
+	bad = 0;
+	for (j = 0; j < h.no_jobs && rc >= 0; j++) {
+		rc = dur_check_target(&t[j], threads, out);
+		if (rc > 0)
+			bad = 1;
+	}
+	if (rc >= 0)
+		rc = bad;
+out:
+	for (j = 0; j < h.no_jobs; j++)
+		free(t[j].acks);
+	free(t);
+	fclose(f);
+	return rc;
+}
@@ -0,0 +1,117 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __DURABILITY_H__
+#define __DURABILITY_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "iob.h"
+
+#define DUR_SECTOR		512
+#define DUR_BLOCK_MAGIC		0x4c42525544424f49ULL	/* "IOBDURBL" */
+#define DUR_JOURNAL_MAGIC	0x4c4e524a44424f49ULL	/* "IOBDJRNL" */
+#define DUR_JOURNAL_VERSION	1
+#define DUR_ACK_BATCH		64	/* acks per journal write, sync none/always */
+#define DUR_SCAN_BYTES		(1024 * 1024)	/* largest read of the scanner */
+
+/*
+ * Every sector of a block starts with the run id and the sequence number
+ * of the write, the first one is followed by the block number and a
+ * checksum of the whole block. A block whose sectors carry different
+ * writes was torn.
+ */
+struct dur_sector {
+	uint64_t	run_id;
+	uint64_t	seq;
+};
+
+struct dur_block {
+	struct dur_sector	s;
+	uint64_t		magic;
+	uint64_t		block;
+	uint64_t		sum;		/* 0 while summing */
+};
+
+/* the journal: header, no_jobs job entries, then ack records */
+struct dur_journal_header {
+	uint64_t	magic;
+	uint32_t	version;
+	uint32_t	no_jobs;
+	uint64_t	run_id;
+};
+
+struct dur_journal_job {
+	char		name[JOB_NAME_LENGTH];
+	char		path[PATH_MAX];
+	char		policy[32];
+	uint64_t	block_size;
+};
+
+/* the write of seq to block is durable, as far as the sync policy says */
+struct dur_record {
+	uint32_t	job;
+	uint32_t	pad;
+	uint64_t	block;
+	uint64_t	seq;
+};
+
+/* the writing side of one worker */
+struct dur_writer {
+	int			fd;		/* journal, O_APPEND */
+	uint64_t		run_id;
+	uint32_t		job;
+	uint64_t		seq;
+	struct dur_record	*recs;		/* written, acked up to no_acked */
+	unsigned int		size;
+	unsigned int		no_recs;
+	unsigned int		no_acked;
+};
+
+int parse_sync(const char *str, int *policy, unsigned int *every);
+
+void sync_name(int policy, unsigned int every, char *buf, size_t len);
+
+/* creates the journal of r and writes its header, the caller closes fd */
+int dur_journal_create(struct run *r, const char *path);
+
+int dur_writer_init(struct dur_writer *w, int fd, uint64_t run_id,
+		int job, unsigned int every);
+
+/* fills buf with the next write to block */
+void dur_fill(struct dur_writer *w, char *buf, unsigned long size,
+		unsigned long block);
+
+/* the last filled block was written; acked later by dur_ack() */
+int dur_written(struct dur_writer *w, unsigned long block);
+
+/* acknowledges everything written so far, returns the number of new acks */
+int dur_ack(struct dur_writer *w, int force);
+
+int dur_writer_close(struct dur_writer *w);
+
+/* scans the targets of a journal with threads threads and reports */
+int dur_check(const char *journal, int threads, FILE *out);
+
+#endif
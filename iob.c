@@ -42,46 +42,49 @@
 #include <fcntl.h>
 #include <sys/ipc.h> 
 #include <sys/shm.h>
+#include <sys/mman.h>
 #include <time.h>
+#include <getopt.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
 
 #include <assert.h>
 
+#include "iob.h"
 #include "random.h"
 #include "ioengine.h"
+#include "metadata.h"
+#include "selfbench.h"
+#include "net.h"
+#include "jobfile.h"
+#include "metrics.h"
+#include "pacing.h"
+#include "slowlog.h"
+#include "suite.h"
+#include "diskstats.h"
+#include "qos.h"
+#include "target.h"
+#include "cache.h"
+#include "durability.h"
 
 
-#define IO_BLOCK_SIZE	4096
 #define MAX_DEVICES	24
 #define MAX_PROC_DEVICE	256
-#define MAX_PROCESSES	2048
-
-#define SEC_TO_MILLI	(10ULL * 10ULL * 10ULL)
-#define SEC_TO_MICRO	((10ULL * 10ULL * 10ULL) * (SEC_TO_MILLI))
-#define SEC_TO_NS	((10ULL * 10ULL * 10ULL) * (SEC_TO_MICRO))
-
-#undef MIN
-#define MIN(a, b)	((a) > (b) ? (b) : (a))
-
-#undef MAX
-#define MAX(a, b)	((a) > (b) ? (a) : (b))
+#define MAX_VERIFIERS	64
 
 extern struct ioengine sync_engine;
 extern struct ioengine psync_engine;
+extern struct ioengine pvsync2_engine;
+extern struct ioengine mmap_engine;
+extern struct ioengine null_engine;
 
 struct ioengine *engines[] = {
 	&sync_engine,
 	&psync_engine,
-};
-
-struct result_data {
-	unsigned long long	total_write_latency;
-	unsigned long long	total_read_latency;
-
-	unsigned long		writes;
-	unsigned long		reads;
-
-	/* input parameters for calculating result */
-	int			device_index;
+	&pvsync2_engine,
+	&mmap_engine,
+	&null_engine,
 };
 
 struct thread_data {
@@ -89,22 +92,158 @@ struct thread_data {
 	unsigned long		end_block;
 	unsigned long		block_size;
 	unsigned int		iterations;	/* # iterations */
-	int			verify;		/* verify wrote data */
+	int			verify;		/* enum verify_mode */
+	int			verifiers;	/* async verify threads */
+	unsigned int		verify_queue;
 	int			random;		/* random IOs */
+	int			read;		/* read instead of write */
 	int			clk_id;		/* clock ID */
 	struct ioengine		*ioengine;	/* selected io engine */
+	unsigned int		batch;		/* blocks per submission */
+	unsigned int		depth;		/* IOs in flight, queued engines */
+	struct pacer		pacer;		/* rate, think time and bursts */
+
+	unsigned long long	slow_threshold;	/* ns, 0: slow IOs not logged */
+	struct slow_ring	*slow;
+	unsigned int		*inflight;	/* IOs in flight on the path */
+	int			job_index;
+	int			worker;
 
 	int			fd;
+	int			*fds;		/* stripe members */
+	int			width;		/* 1: not striped */
+	unsigned long		chunk_blocks;	/* stripe chunk in blocks */
+
+	unsigned long		stride;		/* bytes from block to block */
+	unsigned long		align;		/* offset_align, 0: stride */
+	unsigned long		skews;		/* random offsets within a block */
+	uint64_t		skew_state;
+	unsigned long		rmw_unit;	/* 0: every IO is aligned to it */
+
+	unsigned long		readahead;	/* bytes, 0: kernel's readahead */
+	unsigned long long	ra_next;	/* readahead issued up to here */
+	struct cache_probe	*probe;		/* NULL: hit ratio not sampled */
+	unsigned int		cache_sample;
+
+	int			breakdown;
+	int			schedstat;	/* fd, -1: run queue not sampled */
+
+	int			sync_policy;	/* enum sync_policy */
+	unsigned int		sync_every;	/* writes per fsync, 0: none */
+	unsigned int		unsynced;
+	struct dur_writer	*dur;		/* NULL: writes not journaled */
 
 	struct result_data	*result;
+	unsigned long long	*cpu_start;	/* self bench, set at first IO */
 };
 
-static const key_t	shm_key	 = 1234;
-static const int	shm_size = sizeof(struct result_data) * MAX_PROCESSES;
-int			shm_id;
-char			*shm = NULL;
 char			**devices;
 
+enum {
+	OPT_MD_DEPTH = 256,
+	OPT_MD_FANOUT,
+	OPT_MD_FILES,
+	OPT_MD_FILE_SIZE,
+	OPT_HIPRI,
+	OPT_NOWAIT,
+	OPT_DSYNC,
+	OPT_BATCH,
+	OPT_MMAP_POPULATE,
+	OPT_MADVISE,
+	OPT_MMAP_HUGE,
+	OPT_SELF_BENCH,
+	OPT_SERVER,
+	OPT_CLIENT,
+	OPT_TOKEN,
+	OPT_ALLOW,
+	OPT_RW,
+	OPT_RATE_IOPS,
+	OPT_METRICS_LISTEN,
+	OPT_THINKTIME,
+	OPT_BURST,
+	OPT_BURST_INTERVAL,
+	OPT_DUTY_ON,
+	OPT_DUTY_OFF,
+	OPT_SLOW_THRESHOLD,
+	OPT_SLOW_RING,
+	OPT_SUITE,
+	OPT_SUITE_JSON,
+	OPT_DISK_INTERVAL,
+	OPT_VERIFY,
+	OPT_VERIFIERS,
+	OPT_VERIFY_QUEUE,
+	OPT_IODEPTH,
+	OPT_IO_MAX,
+	OPT_IO_WEIGHT,
+	OPT_IOPRIO,
+	OPT_CGROUP_ROOT,
+	OPT_STRIPE,
+	OPT_FADVISE,
+	OPT_READAHEAD,
+	OPT_DROP_CACHE,
+	OPT_CACHE_SAMPLE,
+	OPT_LAT_BREAKDOWN,
+	OPT_OFFSET_ALIGN,
+	OPT_SYNC,
+	OPT_DURABILITY,
+	OPT_CHECK_DURABILITY,
+};
+
+static const struct option long_options[] = {
+	{ "metadata",		no_argument,		NULL, 'M' },
+	{ "md-depth",		required_argument,	NULL, OPT_MD_DEPTH },
+	{ "md-fanout",		required_argument,	NULL, OPT_MD_FANOUT },
+	{ "md-files",		required_argument,	NULL, OPT_MD_FILES },
+	{ "md-file-size",	required_argument,	NULL, OPT_MD_FILE_SIZE },
+	{ "hipri",		no_argument,		NULL, OPT_HIPRI },
+	{ "nowait",		no_argument,		NULL, OPT_NOWAIT },
+	{ "dsync",		no_argument,		NULL, OPT_DSYNC },
+	{ "batch",		required_argument,	NULL, OPT_BATCH },
+	{ "mmap-populate",	no_argument,		NULL, OPT_MMAP_POPULATE },
+	{ "madvise",		required_argument,	NULL, OPT_MADVISE },
+	{ "mmap-huge",		no_argument,		NULL, OPT_MMAP_HUGE },
+	{ "self-bench",		optional_argument,	NULL, OPT_SELF_BENCH },
+	{ "server",		required_argument,	NULL, OPT_SERVER },
+	{ "client",		required_argument,	NULL, OPT_CLIENT },
+	{ "token",		required_argument,	NULL, OPT_TOKEN },
+	{ "allow",		required_argument,	NULL, OPT_ALLOW },
+	{ "job-file",		required_argument,	NULL, 'f' },
+	{ "rw",			required_argument,	NULL, OPT_RW },
+	{ "rate-iops",		required_argument,	NULL, OPT_RATE_IOPS },
+	{ "metrics-listen",	required_argument,	NULL, OPT_METRICS_LISTEN },
+	{ "thinktime",		required_argument,	NULL, OPT_THINKTIME },
+	{ "burst",		required_argument,	NULL, OPT_BURST },
+	{ "burst-interval",	required_argument,	NULL, OPT_BURST_INTERVAL },
+	{ "duty-on",		required_argument,	NULL, OPT_DUTY_ON },
+	{ "duty-off",		required_argument,	NULL, OPT_DUTY_OFF },
+	{ "slow-threshold",	required_argument,	NULL, OPT_SLOW_THRESHOLD },
+	{ "slow-ring",		required_argument,	NULL, OPT_SLOW_RING },
+	{ "suite",		required_argument,	NULL, OPT_SUITE },
+	{ "suite-json",		required_argument,	NULL, OPT_SUITE_JSON },
+	{ "disk-interval",	required_argument,	NULL, OPT_DISK_INTERVAL },
+	{ "verify",		required_argument,	NULL, OPT_VERIFY },
+	{ "verifiers",		required_argument,	NULL, OPT_VERIFIERS },
+	{ "verify-queue",	required_argument,	NULL, OPT_VERIFY_QUEUE },
+	{ "iodepth",		required_argument,	NULL, OPT_IODEPTH },
+	{ "engine-option",	required_argument,	NULL, 'O' },
+	{ "io-max",		required_argument,	NULL, OPT_IO_MAX },
+	{ "io-weight",		required_argument,	NULL, OPT_IO_WEIGHT },
+	{ "ioprio",		required_argument,	NULL, OPT_IOPRIO },
+	{ "cgroup-root",	required_argument,	NULL, OPT_CGROUP_ROOT },
+	{ "stripe",		required_argument,	NULL, OPT_STRIPE },
+	{ "fadvise",		required_argument,	NULL, OPT_FADVISE },
+	{ "readahead",		required_argument,	NULL, OPT_READAHEAD },
+	{ "drop-cache",		no_argument,		NULL, OPT_DROP_CACHE },
+	{ "cache-sample",	required_argument,	NULL, OPT_CACHE_SAMPLE },
+	{ "lat-breakdown",	no_argument,		NULL, OPT_LAT_BREAKDOWN },
+	{ "offset-align",	required_argument,	NULL, OPT_OFFSET_ALIGN },
+	{ "sync",		required_argument,	NULL, OPT_SYNC },
+	{ "durability",		required_argument,	NULL, OPT_DURABILITY },
+	{ "check-durability",	required_argument,	NULL, OPT_CHECK_DURABILITY },
+	{ "help",		no_argument,		NULL, 'h' },
+	{ NULL,			0,			NULL, 0 },
+};
+
 void usage(char *str)
 {
 	char buf[1024];
@@ -128,19 +267,202 @@ void usage(char *str)
 	sprintf(buf, "Block size for IO. (%d)", IO_BLOCK_SIZE);
 	fprintf(stderr, "\t%-20s\t%s\n", "-b <block size>", buf);
 
+	fprintf(stderr, "\t%-20s\t%s\n", "--sync <policy>",
+			"none, always, fsync[:n] or fdatasync[:n] writes.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--durability <journal>",
+			"Write checkable blocks, journal acknowledged writes.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--check-durability <journal>",
+			"Scan for lost or torn acknowledged writes, -n threads.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--offset-align <size>",
+			"IO offsets are multiples of this, e.g. 512. (block size)");
+
 	fprintf(stderr, "\t%-20s\t%s\n", "-R", "Random IOs");
 
+	fprintf(stderr, "\t%-20s\t%s\n", "--rw <pattern>",
+			"write, randwrite, read or randread. (write)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--rate-iops <iops>",
+			"Limit IOPS for each path. (0, no limit)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--thinktime <usec>",
+			"Pause after each IO, between bursts if bursty. (0)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--burst <# IOs>",
+			"IOs issued back to back every burst interval.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--burst-interval <usec>",
+			"Time from the start of one burst to the next.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--duty-on <usec>",
+			"Duty cycle: time of back to back IO ...");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--duty-off <usec>",
+			"... followed by this much quiet time.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--io-max <limits>",
+			"cgroup io.max of each job: rbps=,wbps=,riops=,wiops=");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--io-weight <weight>",
+			"cgroup io.weight of each job, 1 to 10000. (100)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--ioprio <class>",
+			"IO priority: rt[:level], be[:level] or idle.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--cgroup-root <dir>",
+			"Where job cgroups are created. (cgroup v2 mount)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--slow-threshold <time>",
+			"Log IOs slower than this, e.g. 10ms. Dump on SIGUSR1.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--slow-ring <entries>",
+			"Most recent slow IOs kept. (1024)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--lat-breakdown",
+			"Split latency into submit, device, reap and run queue delay.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--disk-interval <time>",
+			"Print block layer stats of the devices this often.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--suite <suite>",
+			"Run the \"standard\" suite or one from a file.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--suite-json <file>",
+			"Write the suite results as JSON.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "-f, --job-file <file>",
+			"Run the jobs of an INI job file concurrently.");
+
 	fprintf(stderr, "\t%-20s\t%s\n", "-E <engine>",
-			"IO engine to use. Either sync or psync. (psync).");
+			"IO engine: sync, psync, pvsync2, mmap or null. (psync).");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "-E <./engine.so>",
+			"Load an engine plugin, see iob_plugin.h.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "-O <key=value>",
+			"Option for the engine plugin, may be repeated.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--iodepth <#>",
+			"IOs each worker keeps in flight, queued engines. (1)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--fadvise <hint>",
+			"normal, sequential, random, willneed, dontneed or noreuse.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--readahead <size>",
+			"readahead() this far ahead of sequential buffered reads.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--drop-cache",
+			"Drop the cached pages of PATHS before the run.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--cache-sample <n>",
+			"Check 1 in n buffered reads for page cache hits. (16)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--hipri",
+			"Polled completion, needs -d. (pvsync2)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--nowait",
+			"Try IO without blocking first. (pvsync2)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--dsync",
+			"Per IO data sync instead of O_SYNC. (pvsync2)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--batch <blocks>",
+			"Write blocks submitted per call. (1, writes only)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--mmap-populate",
+			"Prefault the mapping. (mmap)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--madvise <advice>",
+			"normal, sequential, random or willneed. (mmap)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--mmap-huge",
+			"Huge page aligned mapping, MADV_HUGEPAGE. (mmap)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--self-bench[=<ops>]",
+			"Measure harness overhead per worker, no PATHS. (1M)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--server <[host:]port>",
+			"Run as agent, take workloads from a controller. (localhost)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--client <host:port>",
+			"Run PATHS on this agent, repeat for more agents.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--token <secret>",
+			"Shared by agents and controller. ($IOB_TOKEN)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--allow <path>",
+			"Path an agent runs jobs on, or below. Repeatable.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--metrics-listen <addr>",
+			"Serve live Prometheus metrics, unix:<path> or [host:]port.");
 
 	fprintf(stderr, "\t%-20s\t%s\n", "-S <size>",
-			"Device size in GB. (10)");
+			"Size to use in GB, or with a k/m/g/t unit. (capacity)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--stripe <chunk>",
+			"One job striped over all PATHS, RAID0 like.");
 
 	fprintf(stderr, "\t%-20s\t%s\n", "-V", "Verify written data.");
 
+	fprintf(stderr, "\t%-20s\t%s\n", "--verify <mode>",
+			"pass: after each pass, strict: each write, async: in background.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--verifiers <#>",
+			"Async verifier threads per worker. (1)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--verify-queue <#>",
+			"Written blocks queued per worker for async verify. (1024)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "-M, --metadata",
+			"Metadata workload on directory PATHS.");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--md-depth <levels>",
+			"Directory tree depth per worker, up to 16. (2)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--md-fanout <dirs>",
+			"Sub directories per directory, up to 4096. (8)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--md-files <files>",
+			"Files per leaf directory. (64)");
+
+	fprintf(stderr, "\t%-20s\t%s\n", "--md-file-size <bytes>",
+			"Bytes written to each created file, up to 1 GiB. (0)");
+
 	fprintf(stderr, "\n");
 }
 
+/*
+ * Shared memory segment for results written by the worker processes. The
+ * segment is removed right away so that it goes away with the last detach.
+ */
+void *alloc_shared(size_t size)
+{
+	int	id;
+	void	*addr;
+
+	if ((id = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600)) < 0) {
+		fprintf(stderr, "shmget failed: %s.\n", strerror(errno));
+		return NULL;
+	}
+
+	addr = shmat(id, NULL, 0);
+	shmctl(id, IPC_RMID, NULL);
+	if (addr == (void *) -1) {
+		fprintf(stderr, "shmat failed: %s.\n", strerror(errno));
+		return NULL;
+	}
+
+	memset(addr, 0, size);
+	return addr;
+}
+
+void free_shared(void *addr)
+{
+	shmdt(addr);
+}
+
 #if !defined(mempcpy)
 void *mempcpy(void *dest, const void *src, size_t n)
 {
@@ -201,7 +523,7 @@ static ssize_t safe_read(int fd, char *buf, size_t nbytes)
         return bc;
 }
 
-static int fill_random_buffer(char *buf, size_t nbytes)
+int fill_random_buffer(char *buf, size_t nbytes)
 {
         int     fd;
         ssize_t rc;
@@ -222,12 +544,29 @@ static int fill_random_buffer(char *buf, size_t nbytes)
         return 0;
 }
 
+static int get_madvise(const char *name)
+{
+	if (!strcmp(name, "normal"))
+		return MADV_NORMAL;
+	if (!strcmp(name, "sequential"))
+		return MADV_SEQUENTIAL;
+	if (!strcmp(name, "random"))
+		return MADV_RANDOM;
+	if (!strcmp(name, "willneed"))
+		return MADV_WILLNEED;
+	return -1;
+}
+
 struct ioengine *get_ioengine(const char *name)
 {
 	int i;
 	int len = IOENGIN_NAME_LENGTH;
 
-	for (i = 0; sizeof(engines) / sizeof(engines[0]); i++) {
+	/* a path names an engine plugin */
+	if (strchr(name, '/'))
+		return plugin_load(name);
+
+	for (i = 0; i < sizeof(engines) / sizeof(engines[0]); i++) {
 		if (!strncmp(engines[i]->name, name, len))
 			return engines[i];
 	}
@@ -237,25 +576,22 @@ struct ioengine *get_ioengine(const char *name)
 static int get_clock_id(void)
 {
 	int i;
+	/*
+	 * Only wall clocks are usable for latency, CPU time clocks do not
+	 * advance while a process sleeps on IO. On a tie the earlier entry
+	 * wins.
+	 */
 	int clk_ids[] = {
-#if defined(CLOCK_PROCESS_CPUTIME_ID)
-		CLOCK_PROCESS_CPUTIME_ID,
-#endif
-
-#if defined(CLOCK_REALTIME)
-		CLOCK_REALTIME,
+#if defined(CLOCK_MONOTONIC_RAW)
+		CLOCK_MONOTONIC_RAW,
 #endif
 
 #if defined(CLOCK_MONOTONIC)
 		CLOCK_MONOTONIC,
 #endif
 
-#if defined(CLOCK_MONOTONIC_RAW)
-		CLOCK_MONOTONIC_RAW,
-#endif
-
-#if defined(CLOCK_THREAD_CPUTIME_ID)
-		CLOCK_THREAD_CPUTIME_ID,
+#if defined(CLOCK_REALTIME)
+		CLOCK_REALTIME,
 #endif
 
 #if defined(CLOCK_MONOTONIC_COARSE)
@@ -289,6 +625,382 @@ unsigned long long get_hrtime(int clk_id)
 	return ts.tv_sec * SEC_TO_NS + ts.tv_nsec;
 }
 
+/* fd and block on it of logical block b */
+static inline int td_map(struct thread_data *td, unsigned long b,
+		unsigned long *db)
+{
+	if (td->width == 1) {
+		*db = b;
+		return td->fd;
+	}
+	return td->fds[stripe_map(b, td->chunk_blocks, td->width, db)];
+}
+
+/*
+ * Byte offset of block b. With an offset alignment below the stride,
+ * random IOs start at any multiple of it within their block.
+ */
+static inline unsigned long long td_offset(struct thread_data *td,
+		unsigned long b)
+{
+	unsigned long long	offset = (unsigned long long) b * td->stride;
+
+	if (td->skews) {
+		td->skew_state ^= td->skew_state << 13;
+		td->skew_state ^= td->skew_state >> 7;
+		td->skew_state ^= td->skew_state << 17;
+		offset += td->skew_state % td->skews * td->align;
+	}
+	return offset;
+}
+
+/* IOs that leave part of a physical block untouched force read-modify-write */
+static inline struct lat_hist *td_align_hist(struct thread_data *td,
+		unsigned long long offset)
+{
+	struct result_data *rd = td->result;
+
+	if (offset % td->rmw_unit || td->block_size % td->rmw_unit)
+		return &rd->unaligned_hist;
+	return &rd->aligned_hist;
+}
+
+/* applies the sync policy after a write and journals what it made durable */
+static int td_written(struct thread_data *td, int fd, unsigned long block)
+{
+	struct result_data	*rd = td->result;
+	unsigned long long	s;
+	int			rc;
+
+	if (td->dur && dur_written(td->dur, block) < 0)
+		return -1;
+
+	if (td->sync_every) {
+		if (++td->unsynced < td->sync_every)
+			return 0;
+		td->unsynced = 0;
+
+		s  = get_hrtime(td->clk_id);
+		if (td->ioengine->sync)
+			rc = td->ioengine->sync(fd,
+					td->sync_policy == SYNC_FDATASYNC);
+		else if (td->sync_policy == SYNC_FDATASYNC)
+			rc = fdatasync(fd);
+		else
+			rc = fsync(fd);
+		if (rc < 0) {
+			fprintf(stderr, "fsync failed: %s\n", strerror(errno));
+			return -1;
+		}
+		lat_hist_add(&rd->sync_hist, get_hrtime(td->clk_id) - s);
+	}
+
+	if (!td->dur)
+		return 0;
+
+	rc = dur_ack(td->dur, td->sync_every != 0);
+	if (rc < 0)
+		return -1;
+	rd->acked += rc;
+	return 0;
+}
+
+/* keeps half a window or more read ahead of offset, the read cursor */
+static void td_readahead(struct thread_data *td, int fd,
+		unsigned long long offset)
+{
+	unsigned long long	end;
+	unsigned long long	len;
+
+	/* a new pass started or the cursor ran past the window */
+	if (offset + td->readahead < td->ra_next || offset >= td->ra_next)
+		td->ra_next = offset;
+
+	end = (unsigned long long) (td->end_block + 1) * td->stride;
+	if (td->ra_next - offset > td->readahead / 2 || td->ra_next >= end)
+		return;
+
+	len = MIN(td->readahead, end - td->ra_next);
+	readahead(fd, td->ra_next, len);
+	td->ra_next += len;
+}
+
+/* blocks of the worker in the order they are issued */
+static unsigned long *io_blocks(struct thread_data *td)
+{
+	unsigned long		blocks;
+	unsigned long		*r_b;
+	struct rand_range	ir;
+	unsigned long		i, b;
+
+	blocks	= td->end_block - td->start_block + 1;
+	r_b	= calloc(blocks, sizeof(*r_b));
+	assert(r_b);
+
+	init_rand_range(&ir, td->start_block, td->end_block);
+	for (i = 0, b = td->start_block; i < blocks; i++, b++) {
+		if (!td->random) {
+			r_b[i] = b;
+			continue;
+		}
+
+		r_b[i] = get_random_range(&ir);
+	}
+	return r_b;
+}
+
+/*
+ * do_io() for engines that queue: keeps up to depth IOs in flight, each
+ * with a buffer of its own, and accounts each IO from its submission to
+ * the reap that returned it.
+ */
+static int do_io_queued(struct thread_data *td)
+{
+	struct ioengine		*ioengine = td->ioengine;
+	struct result_data	*rd = td->result;
+	struct pacer		*pacer = &td->pacer;
+	unsigned long		block_size = td->block_size;
+	unsigned long		iterations = td->iterations;
+	unsigned long		blocks;
+	unsigned long		*r_b;
+	unsigned long		i;
+	struct iob_io		*ios;
+	struct iob_io		**free_ios, **batch, **done;
+	void			**bufs;
+	unsigned long long	*sub_ns, *runq;	/* by IO, breakdown only */
+	unsigned int		*qd;		/* by IO, in flight at issue */
+	enum pace_phase		*phases;	/* by IO, pacing phase at issue */
+	unsigned int		no_free, nr, inflight, path_inflight;
+	unsigned long long	now, d, c, q;
+	unsigned long long	issued;
+	struct slow_entry	se;
+	enum pace_phase		phase;
+	int			more;
+	int			rc, k, ret;
+
+	blocks   = td->end_block - td->start_block + 1;
+	r_b      = io_blocks(td);
+	ios      = calloc(td->depth, sizeof(*ios));
+	free_ios = calloc(td->depth, sizeof(*free_ios));
+	batch    = calloc(td->depth, sizeof(*batch));
+	done     = calloc(td->depth, sizeof(*done));
+	bufs     = calloc(td->depth, sizeof(*bufs));
+	sub_ns   = calloc(td->depth, sizeof(*sub_ns));
+	runq     = calloc(td->depth, sizeof(*runq));
+	qd       = calloc(td->depth, sizeof(*qd));
+	phases   = calloc(td->depth, sizeof(*phases));
+	assert(ios && free_ios && batch && done && bufs && sub_ns && runq && qd &&
+			phases);
+
+	for (k = 0; k < td->depth; k++) {
+		bufs[k] = memalign(IO_BLOCK_SIZE, block_size);
+		assert(bufs[k]);
+		if (!td->read)
+			fill_random_buffer(bufs[k], block_size);
+
+		ios[k].buf    = bufs[k];
+		ios[k].length = block_size;
+		ios[k].write  = !td->read;
+		free_ios[k]   = &ios[k];
+	}
+	no_free  = td->depth;
+	inflight = 0;
+
+	ret = -1;
+	if (ioengine->register_buffers && ioengine->register_buffers(td->fd,
+				bufs, td->depth, block_size) < 0)
+		goto out;
+
+	rd->total_write_latency = 0;
+	rd->writes              = 0;
+	rd->total_read_latency  = 0;
+	rd->reads               = 0;
+	lat_hist_init(&rd->write_hist);
+	lat_hist_init(&rd->read_hist);
+	lat_hist_init(&rd->burst_hist);
+	lat_hist_init(&rd->quiet_hist);
+	lat_hist_init(&rd->aligned_hist);
+	lat_hist_init(&rd->unaligned_hist);
+	breakdown_init(&rd->breakdown);
+	rd->cache_samples = 0;
+	rd->cache_hits    = 0;
+	rd->start_ns = get_hrtime(td->clk_id);
+
+	phase    = PACE_NONE;
+	q        = 0;
+	issued   = 0;
+	more     = 1;
+	i        = 0;
+	while (more || inflight) {
+		/* fill the queue, one IO at a time when paced */
+		nr = 0;
+		while (more && no_free) {
+			if (pacer->active) {
+				if (nr)
+					break;
+				phase = pacer_wait(pacer);
+			}
+
+			batch[nr] = free_ios[--no_free];
+			batch[nr]->offset = td_offset(td, r_b[i]);
+			batch[nr]->result = 0;
+			phases[batch[nr] - ios] = phase;
+
+			/* sampled before the read brings the block in */
+			if (td->probe && !(issued++ % td->cache_sample)) {
+				rc = cache_probe_resident(td->probe,
+						batch[nr]->offset, block_size);
+				if (rc >= 0) {
+					rd->cache_samples++;
+					rd->cache_hits += rc;
+				}
+			}
+			nr++;
+
+			if (++i == blocks) {
+				i = 0;
+				if (iterations && !--iterations)
+					more = 0;
+			}
+		}
+
+		if (nr) {
+			if (td->schedstat >= 0)
+				q = schedstat_run_delay(td->schedstat);
+			now = get_hrtime(td->clk_id);
+			for (k = 0; k < nr; k++) {
+				batch[k]->issue_ns    = now;
+				batch[k]->complete_ns = 0;
+			}
+
+			rc = ioengine->submit(td->fd, batch, nr);
+			if (rc < 0 || (!rc && !inflight)) {
+				fprintf(stderr, "%s submit failed: %s\n",
+						ioengine->name, rc < 0 ?
+						strerror(-rc) : "nothing queued");
+				goto out;
+			}
+
+			if (td->inflight && rc) {
+				path_inflight = __atomic_add_fetch(td->inflight, rc,
+						__ATOMIC_RELAXED);
+				for (k = 0; k < rc; k++)
+					qd[batch[k] - ios] = path_inflight;
+			}
+
+			/* the whole call is charged to each IO it queued */
+			if (td->breakdown) {
+				d = get_hrtime(td->clk_id);
+				for (k = 0; k < rc; k++) {
+					lat_hist_add(&rd->breakdown.submit, d - now);
+					sub_ns[batch[k] - ios] = d;
+					runq[batch[k] - ios]   = q;
+				}
+			}
+
+			/* not accepted, issue them again later */
+			for (k = rc; k < nr; k++)
+				free_ios[no_free++] = batch[k];
+			inflight += rc;
+			if (pacer->active)
+				pacer_done(pacer, rc);
+		}
+
+		if (!inflight)
+			continue;
+
+		/* wait for one IO when nothing more can be queued */
+		rc = ioengine->reap(td->fd, done,
+				(more && no_free) ? 0 : 1, inflight);
+		if (rc < 0) {
+			fprintf(stderr, "%s reap failed: %s\n", ioengine->name,
+					strerror(-rc));
+			goto out;
+		}
+		inflight -= rc;
+		if (td->inflight)
+			__atomic_sub_fetch(td->inflight, rc, __ATOMIC_RELAXED);
+
+		rd->end_ns = get_hrtime(td->clk_id);
+		if (td->schedstat >= 0)
+			q = schedstat_run_delay(td->schedstat);
+		for (k = 0; k < rc; k++) {
+			if (done[k]->result != block_size) {
+				fprintf(stderr, td->read ? "Reading block failed.\n" :
+						"Writing block failed.\n");
+				goto out;
+			}
+
+			/* engines that do not stamp completions have no reap part */
+			if (td->breakdown) {
+				c = done[k]->complete_ns;
+				if (c < sub_ns[done[k] - ios] || c > rd->end_ns)
+					c = rd->end_ns;
+				else
+					lat_hist_add(&rd->breakdown.reap,
+							rd->end_ns - c);
+				lat_hist_add(&rd->breakdown.device,
+						c - sub_ns[done[k] - ios]);
+				if (td->schedstat >= 0)
+					lat_hist_add(&rd->breakdown.runq,
+							q - runq[done[k] - ios]);
+			}
+
+			d = rd->end_ns - done[k]->issue_ns;
+			if (td->slow_threshold && d >= td->slow_threshold) {
+				se.issue_ns   = done[k]->issue_ns;
+				se.latency_ns = d;
+				se.offset     = done[k]->offset;
+				se.size       = block_size;
+				se.inflight   = qd[done[k] - ios];
+				se.job        = td->job_index;
+				se.worker     = td->worker;
+				se.cpu        = sched_getcpu();
+				se.write      = !td->read;
+				slow_ring_record(td->slow, &se);
+			}
+			if (td->rmw_unit)
+				lat_hist_add(td_align_hist(td, done[k]->offset),
+						d);
+			if (phases[done[k] - ios] == PACE_BURST)
+				lat_hist_add(&rd->burst_hist, d);
+			else if (phases[done[k] - ios] == PACE_QUIET)
+				lat_hist_add(&rd->quiet_hist, d);
+
+			if (td->read) {
+				lat_hist_add(&rd->read_hist, d);
+				rd->total_read_latency += d;
+				rd->reads++;
+			} else {
+				lat_hist_add(&rd->write_hist, d);
+				rd->total_write_latency += d;
+				rd->writes++;
+			}
+			free_ios[no_free++] = done[k];
+		}
+	}
+	ret = 0;
+
+out:
+	/* IOs still in flight after an error are not on the path anymore */
+	if (td->inflight && inflight)
+		__atomic_sub_fetch(td->inflight, inflight, __ATOMIC_RELAXED);
+
+	for (k = 0; k < td->depth; k++)
+		free(bufs[k]);
+	free(bufs);
+	free(sub_ns);
+	free(runq);
+	free(qd);
+	free(phases);
+	free(ios);
+	free(free_ios);
+	free(batch);
+	free(done);
+	free(r_b);
+	return ret;
+}
+
 int do_io(struct thread_data *td)
 {
 	int			rc;
@@ -302,10 +1014,9 @@ int do_io(struct thread_data *td)
 	struct ioengine		*ioengine;
 
 	unsigned long		blocks;
-	int			r_b_size;
 	unsigned long		*r_b;
-	struct rand_range	ir;
 	int			i;
+	int			nr;
 	unsigned long		block_size = td->block_size;
 
 	unsigned long		b;
@@ -315,6 +1026,18 @@ int do_io(struct thread_data *td)
 
 	unsigned long long s;
 	unsigned long long d;
+	unsigned long long q;
+	unsigned long long off;
+	struct pacer	   *pacer = &td->pacer;
+	enum pace_phase	   phase;
+	unsigned int	   inflight;
+	struct slow_entry  se;
+	struct verifier	   v;
+	uint64_t	   seed;
+	int		   failed;
+
+	if (td->depth > 1)
+		return do_io_queued(td);
 
 	buf = memalign(IO_BLOCK_SIZE, block_size);
 	assert(buf);
@@ -330,46 +1053,199 @@ int do_io(struct thread_data *td)
 	ioengine	= td->ioengine;
 
 	blocks		= eb - sb + 1;
-	r_b_size	= sizeof(*r_b) * blocks;
-	r_b		= malloc(r_b_size);
-	assert(r_b);
-	memset(r_b, 0, r_b_size);
-
-	init_rand_range(&ir, sb, eb);
-	for (i = 0, b = sb ; i < blocks; i++, b++) {
-		if (!td->random) {
-			r_b[i] = b;
-			continue;
-		}
-
-		r_b[i] = get_random_range(&ir);
-	}
+	r_b		= io_blocks(td);
 
 	rd->total_write_latency = 0;
 	rd->writes              = 0;
 	rd->total_read_latency  = 0;
 	rd->reads               = 0;
+	lat_hist_init(&rd->write_hist);
+	lat_hist_init(&rd->read_hist);
+	lat_hist_init(&rd->burst_hist);
+	lat_hist_init(&rd->quiet_hist);
+	lat_hist_init(&rd->aligned_hist);
+	lat_hist_init(&rd->unaligned_hist);
+	lat_hist_init(&rd->sync_hist);
+	lat_hist_init(&rd->batch_hist);
+	breakdown_init(&rd->breakdown);
+	rd->acked         = 0;
+	rd->cache_samples = 0;
+	rd->cache_hits    = 0;
+	phase = PACE_NONE;
+	inflight = 0;
+	q = 0;
+
+	/* seeds are unique within the worker, it owns its blocks */
+	seed = (uint64_t) td->worker << 40;
+	if (td->verify == VERIFY_ASYNC && verifier_start(&v, fd, sb, blocks,
+				block_size, td->verifiers, td->verify_queue,
+				clk_id, &rd->verify) < 0)
+		return -1;
+
+	if (td->verify == VERIFY_STRICT) {
+		lb = (char *) memalign(IO_BLOCK_SIZE, block_size);
+		assert(lb);
+	}
+
+	rd->start_ns = get_hrtime(clk_id);
+	if (td->cpu_start)
+		*td->cpu_start = get_hrtime(CLOCK_THREAD_CPUTIME_ID);
+	failed = 0;
 
 	while (!use_iteration || iterations) {
-		fill_random_buffer(buf, block_size);
-
-		s  = get_hrtime(clk_id);
-		/* write blocks */
-		for (i = 0; i < blocks; i++) {
-			if (ioengine->write_block(fd, buf, r_b[i],
-						block_size) < 0) {
-				fprintf(stderr, "Writing block failed.\n");
+		if (!td->read && td->verify != VERIFY_ASYNC)
+			fill_random_buffer(buf, block_size);
+
+		/*
+		 * read or write blocks, results are updated per IO so that a
+		 * worker killed at the end of a timed run still accounts its IOs
+		 */
+		for (i = 0; i < blocks; i += nr) {
+			if (pacer->active)
+				phase = pacer_wait(pacer);
+
+			nr = td->read || td->batch <= 1 || td->width > 1 ||
+				td->align || td->dur || td->sync_every ||
+				!ioengine->write_blocks ?
+				1 : MIN(td->batch, blocks - i);
+			if (td->inflight)
+				inflight = __atomic_add_fetch(td->inflight, nr,
+						__ATOMIC_RELAXED);
+
+			/* content derived from a seed the verifiers can replay */
+			if (td->verify == VERIFY_ASYNC) {
+				verify_fill(buf, block_size, ++seed);
+				for (j = 0; j < nr; j++)
+					verifier_writing(&v, r_b[i + j], seed);
+			}
+
+			fd  = td_map(td, r_b[i], &b);
+			off = td_offset(td, b);
+			if (td->dur)
+				dur_fill(td->dur, buf, block_size, b);
+			if (td->read && td->readahead)
+				td_readahead(td, fd, off);
+
+			/* sampled before the read brings the block in */
+			if (td->probe && !(rd->reads % td->cache_sample)) {
+				rc = cache_probe_resident(td->probe, off,
+						block_size);
+				if (rc >= 0) {
+					rd->cache_samples++;
+					rd->cache_hits += rc;
+				}
+			}
+
+			if (td->schedstat >= 0)
+				q = schedstat_run_delay(td->schedstat);
+
+			s  = get_hrtime(clk_id);
+			if (td->read && td->align) {
+				rc = ioengine->read_at(fd, buf, off, block_size);
+			} else if (td->read) {
+				rc = ioengine->read_block(fd, buf, b, block_size);
+			} else if (td->align) {
+				rc = ioengine->write_at(fd, buf, off, block_size);
+			} else if (nr > 1) {
+				rc = ioengine->write_blocks(fd, buf, r_b + i,
+						nr, block_size);
+			} else {
+				rc = ioengine->write_block(fd, buf, b, block_size);
+			}
+			if (rc < 0) {
+				fprintf(stderr, td->read ? "Reading block failed.\n" :
+						"Writing block failed.\n");
+				return -1;
+			}
+			rd->end_ns = get_hrtime(clk_id);
+			d  = rd->end_ns - s;
+			if (pacer->active)
+				pacer_done(pacer, nr);
+
+			/* the IO was on the device unless we were waiting */
+			if (td->breakdown) {
+				if (td->schedstat >= 0) {
+					q = schedstat_run_delay(td->schedstat) - q;
+					lat_hist_add(&rd->breakdown.runq, q);
+				} else {
+					q = 0;
+				}
+				lat_hist_add(&rd->breakdown.device, d > q ? d - q : 0);
+			}
+
+			if (td->inflight) {
+				__atomic_sub_fetch(td->inflight, nr,
+						__ATOMIC_RELAXED);
+
+				if (td->slow_threshold &&
+						d >= td->slow_threshold) {
+					se.issue_ns   = s;
+					se.latency_ns = d;
+					se.offset     = td->align ? off :
+						(unsigned long long) r_b[i] *
+						block_size;
+					se.size       = nr * block_size;
+					se.inflight   = inflight;
+					se.job        = td->job_index;
+					se.worker     = td->worker;
+					se.cpu        = sched_getcpu();
+					se.write      = !td->read;
+					slow_ring_record(td->slow, &se);
+				}
+			}
+
+			if (td->rmw_unit)
+				lat_hist_add(td_align_hist(td, off), d);
+
+			/* per IO histograms take a batch as nr equal IOs */
+			if (nr > 1)
+				lat_hist_add(&rd->batch_hist, d);
+			if (phase == PACE_BURST)
+				lat_hist_add_n(&rd->burst_hist, d / nr, nr);
+			else if (phase == PACE_QUIET)
+				lat_hist_add_n(&rd->quiet_hist, d / nr, nr);
+
+			if (td->read) {
+				lat_hist_add(&rd->read_hist, d);
+				rd->total_read_latency += d;
+				rd->reads += nr;
+			} else {
+				lat_hist_add_n(&rd->write_hist, d / nr, nr);
+				rd->total_write_latency += d;
+				rd->writes += nr;
+			}
+
+			if (!td->read && (td->sync_every || td->dur) &&
+					td_written(td, fd, b) < 0)
 				return -1;
+
+			if (td->verify == VERIFY_ASYNC) {
+				for (j = 0; j < nr; j++)
+					verifier_queue(&v, r_b[i + j], seed,
+							rd->end_ns);
+			} else if (td->verify == VERIFY_STRICT) {
+				for (j = 0; j < nr; j++) {
+					fd = td_map(td, r_b[i + j], &b);
+					rc = ioengine->read_block(fd, lb, b,
+							block_size);
+					if (rc < 0) {
+						fprintf(stderr, "Reading block failed.\n");
+						return -1;
+					}
+
+					if (memcmp(lb, buf, block_size)) {
+						printf("Possible Data Corruption at "
+								"block %lu\n", r_b[i + j]);
+						exit(1);
+					}
+				}
 			}
 		}
-		d  = get_hrtime(clk_id) - s;
-		rd->total_write_latency += d;
-		rd->writes += blocks;
 
 		if (iterations > 0)
 			iterations--;
 
-		if (!td->verify)
+		if (td->verify != VERIFY_PASS)
 			continue;
 
 		if (!lb) {
@@ -380,7 +1256,8 @@ int do_io(struct thread_data *td)
 		for (j = 0; j < 2; j++) {
 			printf("Running verification: %d\n", j);
 			for (i = 0; i < blocks; i++) {
-				rc = ioengine->read_block(fd, lb, r_b[i], block_size);
+				fd = td_map(td, r_b[i], &b);
+				rc = ioengine->read_block(fd, lb, b, block_size);
 				if (rc < 0) {
 					fprintf(stderr, "Reading block failed.\n");
 					return -1;
@@ -395,303 +1272,908 @@ int do_io(struct thread_data *td)
 		}
 	}
 
+	if (td->verify == VERIFY_ASYNC && verifier_stop(&v) < 0)
+		failed = 1;
+
 	free(buf);
 	free(lb);
-	return 0;
+	return failed ? -1 : 0;
 }
 
-int main(int argc, char *argv[])
+/*
+ * Reads ops blocks with the null engine through do_io(), exactly as a
+ * worker issues them, and returns the thread CPU time of the IO loop or
+ * -1. Block list setup comes before the clock starts and reads leave out
+ * the buffer fill, so this is the harness cost per IO for --self-bench.
+ */
+long long null_io_cpu_ns(unsigned long block_size, unsigned long ops,
+		int random, int clk_id)
 {
-	char		*program;	/* program name */
-	int		direct;		/* set when direct IO */
-	int		procs;		/* number of processes */
-	unsigned long	seconds;	/* number of seconds to run */
-	unsigned long	iterations;	/* number of iterations */
-	int		verify;
-	int		random;		/* radom writes and reads */
-	int		clk_id;		/* clock ID for high resolution timer */
-	char		*s_engine;	/* IO Engine name */
-	int		opt;
-	int		no_devices;
-	int		open_flags;
-
-	int			dev_size_gb;	/* device sizre in GB */
-	unsigned long long	dev_size;	/* device size in bytes */
-	unsigned long		block_size;	/* device block size */
-	unsigned long		blocks;		/* # total blocks */
-	unsigned long		p_blocks;	/* # blocks for each proccess */
-
-	pid_t 		pids[MAX_PROCESSES];
-	pid_t		pid;
-	unsigned long	start_block;
-	unsigned long	end_block;
-	int		i;
-	int		d;
-
+	struct thread_data	td;
 	struct result_data	*rd;
-	struct ioengine		*ioengine;
+	unsigned long long	s, e;
+	int			rc;
 
-	unsigned long		total_reads, total_writes;
-	unsigned long long	avg_write_latency, avg_read_latency;
-	unsigned long long	write_latency, read_latency;
-	unsigned long long	read_bw, write_bw;
-	unsigned long long	w_max_l, w_min_l;
-	unsigned long long	all_w_max_lat, all_w_min_lat, all_w_bw;
-	unsigned long long	all_w_avg_lat;
+	rd = calloc(1, sizeof(*rd));
+	if (!rd)
+		return -1;
+
+	memset(&td, 0, sizeof(td));
+	td.start_block	= 0;
+	td.end_block	= ops - 1;
+	td.block_size	= block_size;
+	td.iterations	= 1;
+	td.random	= random;
+	td.read		= 1;
+	td.clk_id	= clk_id;
+	td.ioengine	= &null_engine;
+	td.batch	= 1;
+	td.depth	= 1;
+	td.fd		= -1;
+	td.width	= 1;
+	td.stride	= block_size;
+	td.schedstat	= -1;
+	td.sync_policy	= SYNC_NONE;
+	td.result	= rd;
+	td.cpu_start	= &s;
+
+	s  = 0;
+	rc = do_io(&td);
+	e  = get_hrtime(CLOCK_THREAD_CPUTIME_ID);
+
+	free(rd);
+	return rc < 0 ? -1 : (long long) (e - s);
+}
 
-	program		= argv[0];
-	direct		= 0;
-	procs		= 1;	/* default only one process */
-	seconds		= 0;
-	iterations	= 1;	/* default: only one iteration */
-	verify		= 0;	/* default: do not verify wrote data */
-	block_size	= IO_BLOCK_SIZE; /* default: block size is 4096 */
-	random		= 0;
-	s_engine	= NULL;
-	ioengine	= &psync_engine; /* default: psync io engine */
-	dev_size_gb	= 10;		/* default: 10 GB */
-	open_flags	= O_RDWR;
-
-	while ((opt = getopt(argc, argv, "dn:s:i:Vb:RE:S:h")) != -1) {
-		switch (opt) {
-		case 'd': /* direct IO */
-			direct = 1;
-			break;
-		case 'n': /* number of processes */
-			procs = atoi(optarg);
-			break;
-		case 's': /* seconds to run */
-			seconds = atol(optarg);
-			break;
-		case 'i': /* number of iterations */
-			iterations = atol(optarg);
-			break;
-		case 'V': /* data verify */
-			verify = 1;
-			break;
-		case 'b': /* block size */
-			block_size = atol(optarg);
-			break;
-		case 'R': /* random */
-			random = 1;
-			break;
-		case 'E': /* IO Engine */
-			s_engine = strdup(optarg);
-			break;
-		case 'S': /* device size in GB */
-			dev_size_gb = atoi(optarg);
-			break;
-		case 'h':
-			usage(program);
-			return 0;
-		}
-	}
+/* bytes from one block to the next, the block size unless offset_align */
+static unsigned long job_stride(struct job *job)
+{
+	if (!job->offset_align)
+		return job->block_size;
+	return (job->block_size + job->offset_align - 1) /
+		job->offset_align * job->offset_align;
+}
 
-	if (optind == argc) {
-		usage(program);
-		return 1;
-	}
+/* random IOs may start anywhere in a block and end in the next one */
+static int job_skews(struct job *job)
+{
+	return job->random && job->offset_align &&
+		job->offset_align < job_stride(job);
+}
 
-	if (direct && !is_power_of_4K(block_size)) {
-		fprintf(stderr, "Direct IO must have block size in multiple "
-					"of 4096\n");
+/*
+ * Worker ranges start on a multiple of the physical block size, optimal IO
+ * size or stripe chunk, whichever is largest, as long as the block size
+ * divides it.
+ */
+static unsigned long job_blocks_per_proc(struct job *job)
+{
+	unsigned long long	size;
+	unsigned long		stride;
+	unsigned long		p_blocks;
+	unsigned long		align;
+
+	stride = job_stride(job);
+	size   = job->dev_size;
+	if (job_skews(job))
+		size = size > stride ? size - stride : 0;
+	p_blocks = size / stride / job->procs;
+
+	align = MAX(job->physical_block_size, job->optimal_io_size);
+	align = MAX(align, job->stripe_chunk);
+	if (align <= stride || align % stride)
+		return p_blocks;
+
+	align /= stride;
+	return p_blocks >= align ? p_blocks - p_blocks % align : p_blocks;
+}
+
+/* body of one worker process */
+static int job_worker(struct run *r, struct job *job, int worker,
+		struct result_data *rd)
+{
+	struct thread_data	td;
+	struct ioengine		*ioengine;
+	unsigned long		p_blocks;
+	unsigned long		pbs;
+	unsigned long long	offset, length;
+	struct cache_probe	probe;
+	struct dur_writer	dur;
+	char			path[PATH_MAX];
+	int			open_flags;
+	int			*fds;
+	int			width;
+	int			dfd;
+	int			rc;
+	int			i;
+
+	ioengine = get_ioengine(job->engine);
+	p_blocks = job_blocks_per_proc(job);
+
+	job->eo.path       = job->path;
+	job->eo.block_size = job->block_size;
+	job->eo.direct     = job->direct;
+	job->eo.clk_id     = r->clk_id;
+	job->eo.sync_policy = job->sync_policy;
+	if (ioengine->init && ioengine->init(ioengine, &job->eo) < 0)
 		return 1;
-	}
 
-	if (direct) {
+	open_flags = O_RDWR;
+	if (job->direct)
 		open_flags |= O_DIRECT;
-	} else {
+	else if (!job->eo.dsync && job->sync_policy == SYNC_DEFAULT)
 		open_flags |= O_SYNC;
-	}
+	if (job->sync_policy == SYNC_ALWAYS)
+		open_flags |= O_DSYNC;
 
-	clk_id = get_clock_id();
-	if (clk_id < 0) {
-		fprintf(stderr, "Finding high resolution clock failed.\n");
+	width = job_stripe_width(job);
+	fds   = calloc(width, sizeof(*fds));
+	if (!fds) {
+		fprintf(stderr, "Memory Allocation Failed.\n");
 		return 1;
 	}
 
-	no_devices = 0;
-	for (i = optind; argv[i]; i++) {
-		devices = realloc(devices, sizeof(devices) * (no_devices + 1));
-		if (!devices) {
-			fprintf(stderr, "Memory Allocation Failed.\n");
+	for (i = 0; i < width; i++) {
+		job_stripe_path(job, i, path, sizeof(path));
+		fds[i] = open(path, open_flags);
+		if (fds[i] < 0) {
+			fprintf(stderr, "open(%s) failed: %s\n", path,
+					strerror(errno));
+			while (i--)
+				close(fds[i]);
 			return 1;
 		}
-
-		devices[no_devices] = strdup(argv[i]);
-		no_devices++;
 	}
-
-
-	if (!procs || (!seconds && !iterations)) {
-		usage(program);
-		return 1;
+	dfd = fds[0];
+
+	td.start_block	= worker * p_blocks;
+	td.end_block	= td.start_block + p_blocks - 1;
+	td.block_size	= job->block_size;
+	td.iterations	= job->iterations;
+	td.fd		= dfd;
+	td.fds		= fds;
+	td.width	= width;
+	td.chunk_blocks	= job->stripe_chunk / job->block_size;
+	td.stride	= job_stride(job);
+	td.align	= job->offset_align;
+	td.skews	= job_skews(job) ? td.stride / td.align : 0;
+	td.skew_state	= 0x9e3779b97f4a7c15ULL * (worker + 1);
+	/* offsets are multiples of the block size or offset_align */
+	pbs = job->physical_block_size;
+	if (pbs > 1 && (job->block_size % pbs || job->offset_align % pbs))
+		td.rmw_unit = pbs;
+	else
+		td.rmw_unit = 0;
+	td.result	= rd;
+	td.verify	= job->verify;
+	td.verifiers	= job->verifiers ? job->verifiers : VERIFY_THREADS;
+	td.verify_queue	= job->verify_queue;
+	td.random	= job->random;
+	td.clk_id	= r->clk_id;
+	td.ioengine	= ioengine;
+	td.batch	= job->eo.batch;
+	td.depth	= job->eo.depth;
+	td.read		= job->read;
+	td.cpu_start	= NULL;
+
+	/* the job's rate is shared by its workers */
+	pacer_init(&td.pacer,
+		job->rate_iops ? SEC_TO_NS * job->procs / job->rate_iops : 0,
+		job->thinktime * (SEC_TO_NS / SEC_TO_MICRO), job->burst,
+		job->burst_interval * (SEC_TO_NS / SEC_TO_MICRO),
+		job->duty_on * (SEC_TO_NS / SEC_TO_MICRO),
+		job->duty_off * (SEC_TO_NS / SEC_TO_MICRO));
+
+	td.readahead	= job->readahead;
+	td.ra_next	= 0;
+	td.probe	= NULL;
+	td.cache_sample	= job->cache_sample;
+	td.sync_policy	= job->sync_policy;
+	td.sync_every	= job->sync_every;
+	td.unsynced	= 0;
+	td.dur		= NULL;
+
+	rc = 0;
+	if (r->journal_path && !job->read) {
+		rc = dur_writer_init(&dur, r->journal, r->run_id,
+				job - r->jobs, job->sync_every);
+		if (!rc)
+			td.dur = &dur;
 	}
 
-	if (procs > MAX_PROC_DEVICE) {
-		fprintf(stderr, "Number of processes should be less than %d\n",
-				MAX_PROCESSES);
-		usage(program);
-		return 1;
+	td.breakdown	= job->lat_breakdown;
+	td.schedstat	= job->lat_breakdown ? schedstat_open() : -1;
+
+	td.slow_threshold = r->slow ? job->slow_threshold : 0;
+	td.slow		= r->slow;
+	td.inflight	= r->inflight ? &r->inflight[job->dev_index] : NULL;
+	td.job_index	= job - r->jobs;
+	td.worker	= worker;
+
+	/* a striped worker may touch any part of each member */
+	offset = (unsigned long long) td.start_block * td.stride;
+	length = (unsigned long long) p_blocks * td.stride;
+	if (td.skews)
+		length += td.stride;
+	if (width > 1) {
+		offset = 0;
+		length = job->dev_size / width;
 	}
 
-	if (s_engine) {
-		ioengine = get_ioengine(s_engine);
-		if (!ioengine) {
-			usage(program);
-			return 1;
+	for (i = 0; i < width && !rc; i++) {
+		if (ioengine->open && ioengine->open(fds[i], offset, length,
+					&rd->engine) < 0) {
+			fprintf(stderr, "IO engine %s open failed.\n",
+					ioengine->name);
+			rc = -1;
 		}
 	}
 
-	if (no_devices * procs > MAX_PROCESSES) {
-		fprintf(stderr, "Will create only %d processes.\n", MAX_PROCESSES);
-		procs = MAX_PROCESSES / no_devices;
+	for (i = 0; i < width && !rc && job->fadvise >= 0; i++)
+		rc = cache_advise(fds[i], offset, width > 1 ? 0 : length,
+				job->fadvise);
+
+	/* page cache hits of buffered reads */
+	if (!rc && job->read && !job->direct && width == 1 &&
+			job->cache_sample && !cache_probe_open(&probe, dfd,
+				offset, length))
+		td.probe = &probe;
+
+	if (!rc)
+		rc = do_io(&td);
+	if (td.probe)
+		cache_probe_close(td.probe);
+	if (td.schedstat >= 0)
+		close(td.schedstat);
+	if (td.dur && dur_writer_close(td.dur) < 0)
+		rc = -1;
+	for (i = 0; i < width; i++) {
+		if (ioengine->close)
+			ioengine->close(fds[i]);
+		close(fds[i]);
 	}
+	free(fds);
+	return rc < 0 ? 1 : 0;
+}
 
-	/* verify device paths */
-	for (i = 0; i < no_devices; i++) {
-		struct stat buf;
+/*
+ * Probes the path, or each member of a striped job, sizes the job to the
+ * capacity unless a size is given and checks the block size against the
+ * device.
+ */
+static int job_geometry(struct job *job)
+{
+	struct geometry		g;
+	struct stat		buf;
+	char			path[PATH_MAX];
+	unsigned long long	capacity;	/* of the smallest member */
+	int			width;
+	int			blk;
+	int			i;
 
-		if (stat(devices[i], &buf) < 0) {
-			fprintf(stderr, "stat(%s) failed: %s\n", devices[i], strerror(errno));
-			return 1;
+	width    = job_stripe_width(job);
+	capacity = 0;
+	blk      = 0;
+	job->logical_block_size  = 0;
+	job->physical_block_size = 0;
+	job->optimal_io_size     = 0;
+
+	for (i = 0; i < width; i++) {
+		if (job_stripe_path(job, i, path, sizeof(path)) < 0) {
+			fprintf(stderr, "%s: invalid path.\n", job->name);
+			return -1;
+		}
+
+		if (stat(path, &buf) < 0) {
+			fprintf(stderr, "stat(%s) failed: %s\n", path,
+					strerror(errno));
+			return -1;
 		}
 
 		switch (buf.st_mode & S_IFMT) {
 		case S_IFBLK:
+			blk = 1;
+			/* fall through */
 		case S_IFCHR:
 		case S_IFREG:
 			break;
 		default:
-			fprintf(stderr, "%s is not a valid block device.\n", devices[i]);
-			usage(program);
-			return 1;	
+			fprintf(stderr, "%s is not a valid block device.\n", path);
+			return -1;
 		}
+
+		if (geometry_probe(path, &g) < 0)
+			return -1;
+
+		job->logical_block_size  = MAX(job->logical_block_size,
+				g.logical);
+		job->physical_block_size = MAX(job->physical_block_size,
+				g.physical);
+		job->optimal_io_size     = MAX(job->optimal_io_size, g.optimal);
+		if (!i || g.capacity < capacity)
+			capacity = g.capacity;
 	}
 
-	if (seconds)
-		iterations = 0;
+	if (job->stripe_chunk) {
+		if (job->stripe_chunk % job->block_size) {
+			fprintf(stderr, "%s: stripe chunk must be a multiple of "
+					"the block size.\n", job->name);
+			return -1;
+		}
+		capacity = capacity / job->stripe_chunk * job->stripe_chunk *
+			width;
+	}
 
-	/* initialize shared memory for results */
-	if ((shm_id = shmget(shm_key, shm_size, IPC_CREAT | 0666)) < 0) {
-		fprintf(stderr, "shmget failed: %s.\n", strerror(errno));
-		return 1;
+	/* files grow, devices do not */
+	if (!job->dev_size) {
+		if (!capacity) {
+			fprintf(stderr, "%s: size unknown, give one with -S.\n",
+					job->name);
+			return -1;
+		}
+		job->dev_size = capacity;
+	} else if (blk && job->dev_size > capacity) {
+		fprintf(stderr, "%s: size %llu is larger than the device, %llu.\n",
+				job->name, job->dev_size, capacity);
+		return -1;
 	}
 
-	if ((shm = shmat(shm_id, NULL, 0)) == (char *) -1) {
-		printf("shmat failed.\n");
-		return 1;
+	if (job->direct && job->block_size % job->logical_block_size) {
+		fprintf(stderr, "Direct IO must have block size in multiple "
+					"of %u\n", job->logical_block_size);
+		return -1;
 	}
 
-	memset(shm, 0, shm_size);
+	if (job->direct && job->offset_align % job->logical_block_size) {
+		fprintf(stderr, "Direct IO must have offset alignment in "
+				"multiple of %u\n", job->logical_block_size);
+		return -1;
+	}
 
-#if 0
-	dev_size = 0;
-	block_size = 0;
+	if (blk && !job->read && job->block_size % job->physical_block_size)
+		fprintf(stderr, "%s: block size is not a multiple of the "
+				"physical block size %u, writes will read-modify-"
+				"write.\n", job->name, job->physical_block_size);
+	return 0;
+}
 
-	dfd = open(device, O_RDONLY);
-	if (dfd < 0) {
-		fprintf(stderr, "open(%s) failed: %s\n", device, strerror(errno));
-		return 1;
+static int job_prepare(struct job *job)
+{
+	struct ioengine	*ioengine;
+
+	ioengine = get_ioengine(job->engine);
+	if (!ioengine) {
+		fprintf(stderr, "%s: unknown IO engine %s.\n", job->name,
+				job->engine);
+		return -1;
 	}
 
-	if (ioctl(dfd, BLKGETSIZE, &dev_size) < 0) {
-		fprintf(stderr, "ioctl(BLKGETSIZE64) failed: %s\n", strerror(errno));
-		close(dfd);
-		return 1;
+	if (!job->procs || job->procs > MAX_PROC_DEVICE) {
+		fprintf(stderr, "%s: number of processes should be between 1 "
+				"and %d\n", job->name, MAX_PROC_DEVICE);
+		return -1;
 	}
 
-	if (ioctl(dfd, BLKBSZGET, &block_size) < 0) {
-		fprintf(stderr, "ioctl(BLKBSZGET) failed: %s\n", strerror(errno));
-		close(dfd);
-		return 1;
+	if (!job->block_size) {
+		fprintf(stderr, "%s: block size must not be 0.\n", job->name);
+		return -1;
+	}
+
+	if (job->burst && !job->burst_interval) {
+		fprintf(stderr, "%s: burst needs a burst interval.\n", job->name);
+		return -1;
+	}
+
+	if (job->burst && job->duty_on) {
+		fprintf(stderr, "%s: use either burst or duty cycle.\n",
+				job->name);
+		return -1;
+	}
+
+	if (job->read && job->verify) {
+		fprintf(stderr, "%s: verify needs a write job.\n", job->name);
+		return -1;
+	}
+
+	if (job->verifiers < 0 || job->verifiers > MAX_VERIFIERS) {
+		fprintf(stderr, "%s: verifiers should be between 1 and %d\n",
+				job->name, MAX_VERIFIERS);
+		return -1;
+	}
+
+	if (job->io_weight > 10000) {
+		fprintf(stderr, "%s: io weight should be between 1 and 10000\n",
+				job->name);
+		return -1;
+	}
+
+	if (!job->eo.batch || job->eo.batch > MAX_BATCH) {
+		fprintf(stderr, "%s: batch should be between 1 and %d.\n",
+				job->name, MAX_BATCH);
+		return -1;
+	}
+
+	if (job->eo.batch > 1 && job->read) {
+		fprintf(stderr, "%s: only writes are batched.\n", job->name);
+		return -1;
+	}
+
+	if (job->eo.hipri && !job->direct) {
+		fprintf(stderr, "%s: --hipri needs -d.\n", job->name);
+		return -1;
+	}
+
+	if ((job->eo.hipri || job->eo.nowait || job->eo.dsync ||
+			job->eo.populate || job->eo.hugepage ||
+			job->eo.advice >= 0) && !ioengine->init) {
+		fprintf(stderr, "IO engine %s does not take engine options.\n",
+				ioengine->name);
+		return -1;
+	}
+
+	if (job->eo.opts[0] && !ioengine->submit) {
+		fprintf(stderr, "IO engine %s does not take -O options.\n",
+				ioengine->name);
+		return -1;
+	}
+
+	if (job->eo.batch > 1 && !ioengine->write_blocks)
+		fprintf(stderr, "IO engine %s does not batch, ignoring "
+				"--batch.\n", ioengine->name);
+
+	if (job->eo.depth > 1 && (!ioengine->submit ||
+				job->eo.depth > ioengine->max_depth)) {
+		fprintf(stderr, "IO engine %s supports a queue depth of %u.\n",
+				ioengine->name, MAX(ioengine->max_depth, 1));
+		return -1;
+	}
+
+	if (job->offset_align && (!ioengine->read_at || job->verify ||
+				job->stripe_chunk)) {
+		fprintf(stderr, "%s: IO engine %s, verify or striping can not "
+				"take an offset alignment.\n", job->name,
+				ioengine->name);
+		return -1;
+	}
+
+	if (job->sync_every && (job->eo.depth > 1 || job->stripe_chunk)) {
+		fprintf(stderr, "%s: fsync policies need synchronous IO to one "
+				"path.\n", job->name);
+		return -1;
+	}
+
+	if (job->readahead && (!job->read || job->random || job->direct ||
+				job->stripe_chunk)) {
+		fprintf(stderr, "%s: readahead needs buffered sequential "
+				"reads of one path.\n", job->name);
+		return -1;
+	}
+
+	if (job->stripe_chunk && (ioengine->submit || ioengine->close ||
+				job->verify == VERIFY_ASYNC)) {
+		fprintf(stderr, "%s: IO engine %s or async verify can not "
+				"stripe.\n", job->name, ioengine->name);
+		return -1;
+	}
+
+	if (job->eo.depth > 1 && (job->verify || job->eo.batch > 1 ||
+				job->readahead)) {
+		fprintf(stderr, "%s: queued IO does not verify, batch or "
+				"readahead.\n", job->name);
+		return -1;
 	}
-	close(dfd);
-#endif
 
-	dev_size	= dev_size_gb * 1024ULL * 1024ULL ; //* 1024ULL;
-	blocks   	= dev_size / block_size;
-	p_blocks 	= blocks / procs;
+	job->eo.path       = job->path;
+	job->eo.block_size = job->block_size;
+	job->eo.direct     = job->direct;
+	job->eo.sync_policy = job->sync_policy;
+	if (ioengine->init && ioengine->init(ioengine, &job->eo) < 0) {
+		fprintf(stderr, "IO engine %s initialization failed.\n",
+				ioengine->name);
+		return -1;
+	}
+
+	if (job_geometry(job) < 0)
+		return -1;
+
+	if (!job_blocks_per_proc(job)) {
+		fprintf(stderr, "%s: device too small for %d processes.\n",
+				job->name, job->procs);
+		return -1;
+	}
+	return 0;
+}
+
+/* jobs on the same file or device share in-flight accounting */
+static void run_dev_index(struct run *r)
+{
+	struct stat	a, b;
+	int		i, j;
+
+	for (j = 0; j < r->no_jobs; j++) {
+		r->jobs[j].dev_index = j;
+		if (stat(r->jobs[j].path, &a) < 0)
+			continue;
+
+		for (i = 0; i < j; i++) {
+			if (stat(r->jobs[i].path, &b) < 0)
+				continue;
+
+			if (S_ISBLK(a.st_mode) ? (S_ISBLK(b.st_mode) &&
+					a.st_rdev == b.st_rdev) :
+					(a.st_dev == b.st_dev &&
+					 a.st_ino == b.st_ino)) {
+				r->jobs[j].dev_index = r->jobs[i].dev_index;
+				break;
+			}
+		}
+	}
+}
+
+/* durability runs write self describing blocks, one at a time */
+static int run_durable_job(struct job *job)
+{
+	if (job->read)
+		return 0;
+
+	if (job->block_size % DUR_SECTOR ||
+			job->block_size < sizeof(struct dur_block)) {
+		fprintf(stderr, "%s: durability needs a block size in multiple "
+				"of %d.\n", job->name, DUR_SECTOR);
+		return -1;
+	}
+
+	if (job->verify || job->offset_align || job->stripe_chunk ||
+			job->eo.depth > 1) {
+		fprintf(stderr, "%s: durability does not verify, stripe, queue "
+				"or take an offset alignment.\n", job->name);
+		return -1;
+	}
+	return 0;
+}
+
+int run_prepare(struct run *r)
+{
+	int	j;
+
+	if (!r->no_jobs)
+		return -1;
+
+	r->no_results = 0;
+	for (j = 0; j < r->no_jobs; j++) {
+		if (!r->seconds && !r->jobs[j].iterations) {
+			fprintf(stderr, "%s: needs iterations or a run time.\n",
+					r->jobs[j].name);
+			return -1;
+		}
+
+		if (job_prepare(&r->jobs[j]) < 0)
+			return -1;
+		if (r->journal_path && run_durable_job(&r->jobs[j]) < 0)
+			return -1;
+		r->no_results += r->jobs[j].procs;
+	}
+
+	if (r->no_results > MAX_PROCESSES) {
+		fprintf(stderr, "Number of processes should be less than %d\n",
+				MAX_PROCESSES);
+		return -1;
+	}
+
+	run_dev_index(r);
+	return 0;
+}
+
+static volatile sig_atomic_t slow_dump_requested;
+
+static void slow_dump_handler(int sig)
+{
+	slow_dump_requested = 1;
+}
+
+/*
+ * Forks all workers. They block on the barrier pipe until run_go() closes
+ * its write end, so that every job starts issuing IO at the same time.
+ */
+int run_start(struct run *r)
+{
+	struct job		*job;
+	struct result_data	*rd;
+	unsigned long		blocks;
+	pid_t			pid;
+	char			c;
+	char			path[PATH_MAX];
+	int			i, j;
+
+	if (r->journal_path) {
+		r->journal = dur_journal_create(r, r->journal_path);
+		if (r->journal < 0)
+			return -1;
+	}
+
+	r->results = alloc_shared(sizeof(*r->results) * r->no_results);
+	r->pids    = calloc(r->no_results, sizeof(*r->pids));
+	r->no_pids = 0;
+	if (!r->results || !r->pids) {
+		fprintf(stderr, "Memory Allocation Failed.\n");
+		return -1;
+	}
+
+	if (pipe(r->barrier) < 0) {
+		fprintf(stderr, "pipe failed: %s\n", strerror(errno));
+		return -1;
+	}
+
+	for (j = 0; j < r->no_jobs; j++)
+		if (r->jobs[j].slow_threshold)
+			break;
+
+	if (j < r->no_jobs) {
+		r->slow     = slow_ring_alloc(r->slow_ring_size ?
+				r->slow_ring_size : 1024);
+		r->inflight = alloc_shared(sizeof(*r->inflight) * r->no_jobs);
+		if (!r->slow || !r->inflight)
+			return -1;
+
+		/* dump the slow IOs seen so far on SIGUSR1 */
+		slow_dump_requested = 0;
+		signal(SIGUSR1, slow_dump_handler);
+	}
 
-	printf("Device Size = %llu\n", dev_size);
-	printf("Device Block Size = %lu\n", block_size);
-	printf("Device Blocks = %lu\n", blocks);
-	printf("Blocks Per Process = %lu\n", p_blocks);
+	r->disks = diskstats_open(r, r->disk_interval);
+	if (!r->disks)
+		return -1;
 
+	if (qos_setup(r, r->cgroup_root) < 0)
+		return -1;
 
-	for (d = 0; d < no_devices; d++) {
-		for (i = 0; i < procs; i++) {
-			struct thread_data td;
-			struct result_data *rd;
-			char               *device;
-			int                dfd;
+	r->cache = calloc(2 * r->no_jobs, sizeof(*r->cache));
+	if (!r->cache) {
+		fprintf(stderr, "Memory Allocation Failed.\n");
+		return -1;
+	}
+
+	for (j = 0; j < r->no_jobs; j++) {
+		job = &r->jobs[j];
+		for (i = 0; job->drop_cache && i < job_stripe_width(job); i++) {
+			job_stripe_path(job, i, path, sizeof(path));
+			if (cache_drop(path) < 0)
+				return -1;
+		}
+	}
+
+	rd = r->results;
+	for (j = 0; j < r->no_jobs; j++) {
+		job    = &r->jobs[j];
+		blocks = job->dev_size / job_stride(job);
+
+		if (!r->quiet) {
+			if (strcmp(job->name, job->path))
+				printf("Job = %s\n", job->name);
+			printf("Device Size = %llu\n", job->dev_size);
+			printf("Device Block Size = %lu\n", job->block_size);
+			if (job->sync_policy != SYNC_DEFAULT && !job->read) {
+				sync_name(job->sync_policy, job->sync_every,
+						path, sizeof(path));
+				printf("Sync Policy = %s\n", path);
+			}
+			if (job->offset_align)
+				printf("Offset Alignment = %lu%s\n",
+						job->offset_align, job_skews(job) ?
+						", random within blocks" : "");
+			printf("Logical/Physical/Optimal IO Size = %u/%u/%u\n",
+					job->logical_block_size,
+					job->physical_block_size,
+					job->optimal_io_size);
+			if (job->stripe_chunk)
+				printf("Stripe = %d paths, chunk %lu\n",
+						job_stripe_width(job),
+						job->stripe_chunk);
+			printf("Device Blocks = %lu\n", blocks);
+			printf("Blocks Per Process = %lu\n",
+					job_blocks_per_proc(job));
+		}
+		fflush(stdout);
 
-			start_block = i * p_blocks;
-			end_block   = start_block + p_blocks - 1;
+		for (i = 0; i < job->procs; i++, rd++) {
+			rd->job_index = j;
 
 			pid = fork();
 			if (pid < 0) {
 				fprintf(stderr, "fork failed: %s\n", strerror(errno));
-				goto error;
+				return -1;
 			} else if (pid) {
-				pids[d * no_devices + i] = pid;
+				r->pids[r->no_pids++] = pid;
 				continue;
 			}
 
 			/* child process */
-
-			device = devices[d];
-			dfd    = open(device, open_flags);
-			if (dfd < 0) {
-				fprintf(stderr, "open(%s) failed: %s\n", device, strerror(errno));
-				return 1;
-			}
+			signal(SIGUSR1, SIG_IGN);
+			close(r->barrier[1]);
+			if (qos_enter(r, j) < 0)
+				exit(1);
+			while (read(r->barrier[0], &c, 1) < 0 && errno == EINTR)
+				;
+			close(r->barrier[0]);
 
 			/* shared memory attached before fork() are shared by child. No need to reattach */
-			rd = (struct result_data *) shm + ((procs * d) + i);
-			rd->device_index = d;
-
-			td.start_block	= start_block;
-			td.end_block	= end_block;
-			td.block_size	= block_size;
-			td.iterations	= iterations;
-			td.fd		= dfd;
-			td.result	= rd;
-			td.verify	= verify;
-			td.random	= random;
-			td.clk_id	= clk_id;
-			td.ioengine	= ioengine;
-
-			do_io(&td);
-			close(dfd);
-			return 0;
+			exit(job_worker(r, job, i, rd));
 		}
 	}
 
-	if (seconds) {
-		unsigned long s = seconds;
+	close(r->barrier[0]);
+	return 0;
+}
+
+/* page cache state of buffered jobs, before (0) or after (1) the run */
+static void run_cache_state(struct run *r, int end)
+{
+	struct job	*job;
+	int		j;
+
+	for (j = 0; j < r->no_jobs; j++) {
+		job = &r->jobs[j];
+		if (!job->direct && !job->stripe_chunk)
+			cache_state(job->path, job->dev_size,
+					&r->cache[2 * j + end]);
+	}
+}
+
+void run_go(struct run *r)
+{
+	r->clock_start = get_hrtime(r->clk_id);
+	r->wall_start  = get_hrtime(CLOCK_REALTIME);
+	run_cache_state(r, 0);
+	diskstats_start(r->disks);
+	close(r->barrier[1]);
+}
+
+/* sleeps up to timeout_ms while serving the monitoring hooks of the run */
+static void run_monitor(struct run *r, int timeout_ms)
+{
+	if (r->slow && slow_dump_requested) {
+		slow_dump_requested = 0;
+		slow_ring_dump(r->slow, r, stdout);
+	}
+
+	diskstats_poll(r->disks, stdout);
+
+	if (r->metrics)
+		metrics_poll(r->metrics, r, timeout_ms);
+	else
+		poll(NULL, 0, timeout_ms);
+}
+
+int run_wait(struct run *r)
+{
+	unsigned long long	deadline;
+	unsigned long long	now;
+	int			timeout;
+	int			alive;
+	int			i;
+	int			status;
+	int			failed;
+
+	deadline = get_hrtime(CLOCK_MONOTONIC) + r->seconds * SEC_TO_NS;
+	failed   = 0;
+	alive    = r->no_pids;
+
+	/* reaped workers have their pid cleared */
+	while (alive) {
+		now = get_hrtime(CLOCK_MONOTONIC);
+		if (r->seconds && now >= deadline) {
+			/* send kill signal to all children */
+			for (i = 0; i < r->no_pids; i++)
+				if (r->pids[i])
+					kill(r->pids[i], SIGKILL);
+			timeout = -1;
+		} else {
+			timeout = 100;
+			if (r->seconds)
+				timeout = MIN(timeout, (deadline - now) /
+						(SEC_TO_NS / SEC_TO_MILLI) + 1);
+			run_monitor(r, timeout);
+		}
 
-		/* sleep for specified time */
-		sleep(s);
+		for (i = 0; i < r->no_pids; i++) {
+			if (!r->pids[i])
+				continue;
+			if (waitpid(r->pids[i], &status, timeout < 0 ? 0 :
+						WNOHANG) <= 0)
+				continue;
 
-		/* send kill signal to all children */
-		for (i = 0; i < procs; i++) {
-			kill(pids[i], SIGKILL);
+			if (WIFEXITED(status) && WEXITSTATUS(status))
+				failed = 1;
+			r->pids[i] = 0;
+			alive--;
 		}
 	}
 
-	for (i = 0; i < no_devices * procs; i++) {
-		waitpid(pids[i], NULL, 0);
+	diskstats_stop(r->disks);
+	run_cache_state(r, 1);
+
+	if (r->slow) {
+		signal(SIGUSR1, SIG_DFL);
+		slow_ring_dump(r->slow, r, stdout);
 	}
+	return failed ? -1 : 0;
+}
 
-	printf("Finished\n");
+/* kills workers that have not been started or are still running */
+void run_abort(struct run *r)
+{
+	int	i;
+
+	for (i = 0; i < r->no_pids; i++)
+		if (r->pids[i])
+			kill(r->pids[i], SIGKILL);
+	close(r->barrier[1]);
+
+	for (i = 0; i < r->no_pids; i++)
+		if (r->pids[i])
+			waitpid(r->pids[i], NULL, 0);
+}
+
+void run_free(struct run *r)
+{
+	slow_ring_free(r->slow);
+	if (r->inflight)
+		free_shared(r->inflight);
+	r->slow     = NULL;
+	r->inflight = NULL;
+
+	diskstats_close(r->disks);
+	r->disks = NULL;
+
+	qos_cleanup(r);
+	free(r->cache);
+	r->cache = NULL;
+
+	if (r->journal_path && r->journal >= 0)
+		close(r->journal);
+	r->journal = -1;
+
+	if (r->results)
+		free_shared(r->results);
+	free(r->pids);
+	r->results = NULL;
+	r->pids    = NULL;
+}
+
+void run_report(struct job *jobs, int no_jobs, struct result_data *results)
+{
+	struct result_data	*rd;
+	struct ioengine		*ioengine;
+	struct job		*job;
+	int			i, j, d;
+	unsigned long long	all_r_bw;
+
+	unsigned long		total_reads, total_writes;
+	unsigned long long	avg_write_latency, avg_read_latency;
+	unsigned long long	write_latency, read_latency;
+	unsigned long long	read_bw, write_bw;
+	unsigned long long	w_max_l, w_min_l, w_l;
+	unsigned long long	all_w_max_lat, all_w_min_lat, all_w_bw;
+	unsigned long long	all_w_avg_lat;
+	struct engine_stats	es;
+	struct lat_hist		w_hist, r_hist;
+	struct lat_hist		b_hist, q_hist;
+	struct lat_hist		a_hist, u_hist, s_hist;
+	struct lat_hist		bt_hist;
+	unsigned long long	acked;
+	struct lat_breakdown	bd;
+	struct verify_stats	vs;
+	double			read_iops, write_iops;
 
 	all_w_bw	= 0;	/* Write BW combining all paths */
 	all_w_min_lat	= 0;	/* Write Minimum latency for all paths */
 	all_w_max_lat	= 0;	/* Write Maximum latency for all paths */
 	all_w_avg_lat	= 0;	/* Write Average latency for all paths  */
-	rd		= (struct result_data *) shm;
-	for (d = 0; d < no_devices; d++) {
+	all_r_bw	= 0;	/* Read BW combining all paths */
+	rd		= results;
+	for (d = 0; d < no_jobs; d++) {
+		job			= &jobs[d];
+		ioengine		= get_ioengine(job->engine);
 		avg_write_latency	= 0;
 		avg_read_latency	= 0;
 		total_writes		= 0;
@@ -702,9 +2184,24 @@ int main(int argc, char *argv[])
 		write_bw		= 0;
 		w_min_l			= 0;
 		w_max_l			= 0;
-
-		for (i = 0; i < procs; i++) {
-			assert (d == rd->device_index);
+		memset(&es, 0, sizeof(es));
+		lat_hist_init(&w_hist);
+		lat_hist_init(&r_hist);
+		lat_hist_init(&b_hist);
+		lat_hist_init(&q_hist);
+		lat_hist_init(&a_hist);
+		lat_hist_init(&u_hist);
+		lat_hist_init(&s_hist);
+		lat_hist_init(&bt_hist);
+		acked = 0;
+		breakdown_init(&bd);
+		memset(&vs, 0, sizeof(vs));
+		lat_hist_init(&vs.lag);
+		read_iops		= 0;
+		write_iops		= 0;
+
+		for (i = 0; i < job->procs; i++) {
+			assert (d == rd->job_index);
 
 			write_latency += rd->total_write_latency;
 			total_writes  += rd->writes;
@@ -712,21 +2209,49 @@ int main(int argc, char *argv[])
 			read_latency  += rd->total_read_latency;
 			total_reads   += rd->reads;
 
-			w_max_l = MAX(w_max_l, rd->total_write_latency);
+			/* per block average of this worker */
+			w_l = rd->writes ? rd->total_write_latency / rd->writes : 0;
+			w_max_l = MAX(w_max_l, w_l);
 
 			if (w_min_l)
-				w_min_l = MIN(w_min_l, rd->total_write_latency);
+				w_min_l = MIN(w_min_l, w_l);
 			else
-				w_min_l = rd->total_write_latency;
-
+				w_min_l = w_l;
+
+			for (j = 0; j < ENGINE_STATS; j++)
+				es.val[j] += rd->engine.val[j];
+
+			lat_hist_merge(&w_hist, &rd->write_hist);
+			lat_hist_merge(&r_hist, &rd->read_hist);
+			lat_hist_merge(&b_hist, &rd->burst_hist);
+			lat_hist_merge(&q_hist, &rd->quiet_hist);
+			lat_hist_merge(&a_hist, &rd->aligned_hist);
+			lat_hist_merge(&u_hist, &rd->unaligned_hist);
+			lat_hist_merge(&s_hist, &rd->sync_hist);
+			lat_hist_merge(&bt_hist, &rd->batch_hist);
+			acked += rd->acked;
+			breakdown_merge(&bd, &rd->breakdown);
+
+			vs.verified   += rd->verify.verified;
+			vs.superseded += rd->verify.superseded;
+			vs.dropped    += rd->verify.dropped;
+			vs.mismatches += rd->verify.mismatches;
+			lat_hist_merge(&vs.lag, &rd->verify.lag);
+
+			/* achieved rate, differs from latency when throttled */
+			if (rd->end_ns > rd->start_ns) {
+				read_iops  += (double) rd->reads * SEC_TO_NS /
+					(rd->end_ns - rd->start_ns);
+				write_iops += (double) rd->writes * SEC_TO_NS /
+					(rd->end_ns - rd->start_ns);
+			}
 			rd++;
 		}
 
-		/* convert to per block */
-		w_min_l = w_min_l / p_blocks;
-		w_max_l = w_max_l / p_blocks;
-
-		printf("\n\nDevice = %s\n", devices[d]);
+		if (strcmp(job->name, job->path))
+			printf("\n\nJob = %s\nDevice = %s\n", job->name, job->path);
+		else
+			printf("\n\nDevice = %s\n", job->path);
 
 		if (total_reads)
 			avg_read_latency = read_latency / total_reads;
@@ -734,22 +2259,76 @@ int main(int argc, char *argv[])
 		if (total_writes)
 			avg_write_latency = write_latency / total_writes;
 
-		if (avg_read_latency) {
-			read_bw = ((double) block_size / (double) avg_read_latency) * SEC_TO_NS * procs;
-			read_bw /= (1024 * 1024);
-		}
-
-		if (avg_write_latency) {
-			write_bw = ((double) block_size / (double) avg_write_latency) * SEC_TO_NS * procs;
-			write_bw /= (1024 * 1024);
-		}
+		/* achieved, queued engines have depth IOs in flight per worker */
+		read_bw  = read_iops * job->block_size / (1024 * 1024);
+		write_bw = write_iops * job->block_size / (1024 * 1024);
 
 		printf("avg_read_latency = %lld\n", avg_read_latency);
 		printf("Read BW  = %llu MB\n", read_bw);
+		if (r_hist.count) {
+			printf("Read IOPS = %.0f\n", read_iops);
+			lat_hist_print("read", &r_hist);
+		}
 
 		printf("avg_write_latency = %lld\n", avg_write_latency);
 		printf("Lat Min = %lld, Lat Max = %lld\n", w_min_l, w_max_l);
 		printf("Write BW = %llu MB\n", write_bw);
+		if (w_hist.count) {
+			printf("Write IOPS = %.0f\n", write_iops);
+			lat_hist_print("write", &w_hist);
+		}
+
+		if (bt_hist.count) {
+			printf("Batches = %llu\n", bt_hist.count);
+			lat_hist_print("batch", &bt_hist);
+		}
+
+		if (s_hist.count) {
+			printf("Syncs = %llu\n", s_hist.count);
+			lat_hist_print("sync", &s_hist);
+		}
+
+		if (acked)
+			printf("Journaled acknowledged writes = %llu\n", acked);
+
+		if (b_hist.count || q_hist.count) {
+			printf("Burst IOs = %llu, Quiet IOs = %llu\n",
+					b_hist.count, q_hist.count);
+			lat_hist_print("burst", &b_hist);
+			lat_hist_print("quiet", &q_hist);
+		}
+
+		/* read-modify-write penalty, unaligned against aligned IOs */
+		if (u_hist.count) {
+			printf("Aligned IOs = %llu, Unaligned IOs = %llu, to %u "
+					"bytes\n", a_hist.count, u_hist.count,
+					job->physical_block_size);
+			lat_hist_print("aligned", &a_hist);
+			lat_hist_print("unalign", &u_hist);
+			if (a_hist.count)
+				printf("Unaligned/aligned latency: avg %.2fx, "
+						"p99 %.2fx\n",
+						(double) u_hist.sum / u_hist.count /
+						((double) a_hist.sum / a_hist.count),
+						(double) lat_hist_percentile(&u_hist, 99.0) /
+						lat_hist_percentile(&a_hist, 99.0));
+		}
+
+		if (job->lat_breakdown)
+			breakdown_print(&bd);
+
+		if (job->verify == VERIFY_ASYNC) {
+			printf("Verified = %llu, superseded = %llu, dropped = %llu, "
+					"mismatches = %llu\n", vs.verified,
+					vs.superseded, vs.dropped, vs.mismatches);
+			lat_hist_print("vlag", &vs.lag);
+		}
+
+		for (j = 0; ioengine && j < ENGINE_STATS; j++) {
+			if (ioengine->stat_names[j])
+				printf("%s %s = %llu\n", ioengine->name,
+						ioengine->stat_names[j], es.val[j]);
+		}
 
 		/* all path combined calculations */
 		all_w_bw += write_bw;
@@ -759,15 +2338,540 @@ int main(int argc, char *argv[])
 			all_w_min_lat = w_min_l;
 		all_w_max_lat = MAX(all_w_max_lat, w_max_l);
 		all_w_avg_lat += avg_write_latency;
+		all_r_bw += read_bw;
 	}
 
 	printf("\nAll devices combined stats: \n");
 	printf("BW = %llu\n", all_w_bw);
 	printf("Lat Min = %llu\n", all_w_min_lat);
 	printf("Lat Max = %llu\n", all_w_max_lat);
-	printf("Lat Avg = %llu\n", all_w_avg_lat / no_devices);
+	printf("Lat Avg = %llu\n", all_w_avg_lat / no_jobs);
+	if (all_r_bw)
+		printf("Read BW = %llu\n", all_r_bw);
+}
+
+int main(int argc, char *argv[])
+{
+	char		*program;	/* program name */
+	unsigned long	seconds;	/* number of seconds to run */
+	int		clk_id;		/* clock ID for high resolution timer */
+	int		opt;
+	int		no_devices;
+	int		metadata;	/* metadata workload */
+	struct md_params md;
+	unsigned long	self_bench;	/* harness self benchmark ops */
+	char		*server;	/* agent listen address */
+	char		**clients;	/* agent addresses */
+	int		no_clients;
+	struct agent_policy policy;	/* of the agent */
+	char		*job_file;
+	unsigned int	slow_ring_size;
+	char		*metrics_addr;	/* Prometheus export address */
+	char		*suite;		/* --suite name or file */
+	char		*suite_json;
+	char		*journal;	/* --durability */
+	char		*check_journal;
+	unsigned long long disk_interval; /* ns, block stats output */
+	char		*cgroup_root;
+	struct metrics	*metrics;
+	unsigned long long dev_size;	/* bytes, 0: capacity of PATHS */
+	unsigned long	stripe_chunk;	/* bytes, 0: one job per path */
+	unsigned long long v;
+	int		i;
+	int		rc;
+
+	struct job	tmpl;		/* options shared by all paths */
+	struct run	run;
+
+	program		= argv[0];
+	seconds		= 0;
+	dev_size	= 0;		/* default: detected */
+	stripe_chunk	= 0;
+	metadata	= 0;
+	md.depth	= 2;
+	md.fanout	= 8;
+	md.files	= 64;
+	md.file_size	= 0;
+	self_bench	= 0;
+	server		= NULL;
+	clients		= NULL;
+	no_clients	= 0;
+	memset(&policy, 0, sizeof(policy));
+	policy.token	= getenv("IOB_TOKEN");
+	job_file	= NULL;
+	slow_ring_size	= 0;
+	metrics_addr	= NULL;
+	metrics		= NULL;
+	suite		= NULL;
+	suite_json	= NULL;
+	journal		= NULL;
+	check_journal	= NULL;
+	disk_interval	= 0;
+	cgroup_root	= NULL;
+
+	memset(&tmpl, 0, sizeof(tmpl));
+	tmpl.procs	= 1;	/* default only one process */
+	tmpl.iterations	= 1;	/* default: only one iteration */
+	tmpl.verify	= 0;	/* default: do not verify wrote data */
+	tmpl.block_size	= IO_BLOCK_SIZE; /* default: block size is 4096 */
+	tmpl.eo.batch	= 1;
+	tmpl.eo.advice	= -1;
+	tmpl.fadvise	= -1;
+	tmpl.cache_sample = CACHE_SAMPLE_DEFAULT;
+	strcpy(tmpl.engine, psync_engine.name); /* default: psync io engine */
+
+	while ((opt = getopt_long(argc, argv, "dn:s:i:Vb:RE:S:Mf:O:h",
+					long_options, NULL)) != -1) {
+		switch (opt) {
+		case 'd': /* direct IO */
+			tmpl.direct = 1;
+			break;
+		case 'n': /* number of processes */
+			tmpl.procs = atoi(optarg);
+			break;
+		case 's': /* seconds to run */
+			seconds = atol(optarg);
+			break;
+		case 'i': /* number of iterations */
+			tmpl.iterations = atol(optarg);
+			break;
+		case 'V': /* data verify */
+			tmpl.verify = VERIFY_PASS;
+			break;
+		case 'b': /* block size */
+			tmpl.block_size = atol(optarg);
+			break;
+		case 'R': /* random */
+			tmpl.random = 1;
+			break;
+		case 'E': /* IO Engine */
+			if (!get_ioengine(optarg)) {
+				usage(program);
+				return 1;
+			}
+			snprintf(tmpl.engine, sizeof(tmpl.engine), "%s", optarg);
+			break;
+		case 'S': /* device size in GB */
+			if (parse_dev_size(optarg, &dev_size) < 0) {
+				usage(program);
+				return 1;
+			}
+			break;
+		case 'M': /* metadata workload */
+			metadata = 1;
+			break;
+		case OPT_MD_DEPTH:
+			if (parse_count(optarg, 0, MD_MAX_DEPTH, &v) < 0) {
+				usage(program);
+				return 1;
+			}
+			md.depth = v;
+			break;
+		case OPT_MD_FANOUT:
+			if (parse_count(optarg, 0, MD_MAX_FANOUT, &v) < 0) {
+				usage(program);
+				return 1;
+			}
+			md.fanout = v;
+			break;
+		case OPT_MD_FILES:
+			if (parse_count(optarg, 0, UINT_MAX, &v) < 0) {
+				usage(program);
+				return 1;
+			}
+			md.files = v;
+			break;
+		case OPT_MD_FILE_SIZE:
+			if (parse_count(optarg, 0, MD_MAX_FILE_SIZE, &v) < 0) {
+				usage(program);
+				return 1;
+			}
+			md.file_size = v;
+			break;
+		case OPT_HIPRI:
+			tmpl.eo.hipri = 1;
+			break;
+		case OPT_NOWAIT:
+			tmpl.eo.nowait = 1;
+			break;
+		case OPT_DSYNC:
+			tmpl.eo.dsync = 1;
+			break;
+		case OPT_BATCH:
+			if (parse_count(optarg, 1, MAX_BATCH, &v) < 0) {
+				usage(program);
+				return 1;
+			}
+			tmpl.eo.batch = v;
+			break;
+		case OPT_MMAP_POPULATE:
+			tmpl.eo.populate = 1;
+			break;
+		case OPT_MADVISE:
+			tmpl.eo.advice = get_madvise(optarg);
+			if (tmpl.eo.advice < 0) {
+				usage(program);
+				return 1;
+			}
+			break;
+		case OPT_MMAP_HUGE:
+			tmpl.eo.hugepage = 1;
+			break;
+		case OPT_SELF_BENCH:
+			self_bench = optarg ? atol(optarg) : 1024 * 1024;
+			break;
+		case OPT_SERVER:
+			server = optarg;
+			break;
+		case OPT_TOKEN:
+			policy.token = optarg;
+			break;
+		case OPT_ALLOW:
+			policy.allow = realloc(policy.allow,
+					sizeof(*policy.allow) * (policy.no_allow + 1));
+			if (!policy.allow) {
+				fprintf(stderr, "Memory Allocation Failed.\n");
+				return 1;
+			}
+			policy.allow[policy.no_allow++] = optarg;
+			break;
+		case OPT_CLIENT:
+			clients = realloc(clients, sizeof(*clients) * (no_clients + 1));
+			if (!clients) {
+				fprintf(stderr, "Memory Allocation Failed.\n");
+				return 1;
+			}
+			clients[no_clients++] = optarg;
+			break;
+		case 'f': /* job file */
+			job_file = optarg;
+			break;
+		case OPT_RW:
+			if (parse_rw(optarg, &tmpl) < 0) {
+				usage(program);
+				return 1;
+			}
+			break;
+		case OPT_RATE_IOPS:
+			tmpl.rate_iops = atol(optarg);
+			break;
+		case OPT_METRICS_LISTEN:
+			metrics_addr = optarg;
+			break;
+		case OPT_THINKTIME:
+			tmpl.thinktime = atol(optarg);
+			break;
+		case OPT_BURST:
+			tmpl.burst = atol(optarg);
+			break;
+		case OPT_BURST_INTERVAL:
+			tmpl.burst_interval = atol(optarg);
+			break;
+		case OPT_DUTY_ON:
+			tmpl.duty_on = atol(optarg);
+			break;
+		case OPT_DUTY_OFF:
+			tmpl.duty_off = atol(optarg);
+			break;
+		case OPT_SLOW_THRESHOLD:
+			if (parse_time(optarg, &tmpl.slow_threshold) < 0) {
+				usage(program);
+				return 1;
+			}
+			break;
+		case OPT_SLOW_RING:
+			slow_ring_size = atoi(optarg);
+			break;
+		case OPT_IO_MAX:
+			if (parse_io_max(optarg, &tmpl) < 0) {
+				usage(program);
+				return 1;
+			}
+			break;
+		case OPT_IO_WEIGHT:
+			if (parse_count(optarg, 1, 10000, &v) < 0) {
+				usage(program);
+				return 1;
+			}
+			tmpl.io_weight = v;
+			break;
+		case OPT_IOPRIO:
+			if (parse_ioprio(optarg, &tmpl.ioprio) < 0) {
+				usage(program);
+				return 1;
+			}
+			break;
+		case OPT_FADVISE:
+			if (parse_fadvise(optarg, &tmpl.fadvise) < 0) {
+				usage(program);
+				return 1;
+			}
+			break;
+		case OPT_READAHEAD:
+			if (parse_size(optarg, &v) < 0) {
+				usage(program);
+				return 1;
+			}
+			tmpl.readahead = v;
+			break;
+		case OPT_DROP_CACHE:
+			tmpl.drop_cache = 1;
+			break;
+		case OPT_CACHE_SAMPLE:
+			if (parse_count(optarg, 0, UINT_MAX, &v) < 0) {
+				usage(program);
+				return 1;
+			}
+			tmpl.cache_sample = v;
+			break;
+		case OPT_SYNC:
+			if (parse_sync(optarg, &tmpl.sync_policy,
+						&tmpl.sync_every) < 0) {
+				usage(program);
+				return 1;
+			}
+			break;
+		case OPT_DURABILITY:
+			journal = optarg;
+			break;
+		case OPT_CHECK_DURABILITY:
+			check_journal = optarg;
+			break;
+		case OPT_OFFSET_ALIGN:
+			if (parse_size(optarg, &v) < 0) {
+				usage(program);
+				return 1;
+			}
+			tmpl.offset_align = v;
+			break;
+		case OPT_LAT_BREAKDOWN:
+			tmpl.lat_breakdown = 1;
+			break;
+		case OPT_STRIPE:
+			if (parse_size(optarg, &v) < 0 || !v) {
+				usage(program);
+				return 1;
+			}
+			stripe_chunk = v;
+			break;
+		case OPT_CGROUP_ROOT:
+			cgroup_root = optarg;
+			break;
+		case OPT_IODEPTH:
+			tmpl.eo.depth = atoi(optarg);
+			break;
+		case 'O': /* engine plugin option, key=value */
+			if (strlen(tmpl.eo.opts) + strlen(optarg) + 2 >
+					sizeof(tmpl.eo.opts)) {
+				usage(program);
+				return 1;
+			}
+			if (tmpl.eo.opts[0])
+				strcat(tmpl.eo.opts, ",");
+			strcat(tmpl.eo.opts, optarg);
+			break;
+		case OPT_VERIFY:
+			if (parse_verify(optarg, &tmpl.verify) < 0) {
+				usage(program);
+				return 1;
+			}
+			break;
+		case OPT_VERIFIERS:
+			tmpl.verifiers = atoi(optarg);
+			break;
+		case OPT_VERIFY_QUEUE:
+			tmpl.verify_queue = atoi(optarg);
+			break;
+		case OPT_DISK_INTERVAL:
+			if (parse_time(optarg, &disk_interval) < 0) {
+				usage(program);
+				return 1;
+			}
+			break;
+		case OPT_SUITE:
+			suite = optarg;
+			break;
+		case OPT_SUITE_JSON:
+			suite_json = optarg;
+			break;
+		case 'h':
+			usage(program);
+			return 0;
+		}
+	}
+
+	clk_id = get_clock_id();
+	if (clk_id < 0) {
+		fprintf(stderr, "Finding high resolution clock failed.\n");
+		return 1;
+	}
+
+	if (metrics_addr) {
+		metrics = metrics_open(metrics_addr);
+		if (!metrics)
+			return 1;
+	}
+
+	if (server) {
+		rc = agent_serve(server, &policy, clk_id, metrics);
+		metrics_close(metrics);
+		return rc;
+	}
+
+	/* 0: every acknowledged write survived, 2: some did not */
+	if (check_journal) {
+		rc = dur_check(check_journal, tmpl.procs, stdout);
+		return rc < 0 ? 1 : rc ? 2 : 0;
+	}
+
+	if (optind == argc && !self_bench && !job_file) {
+		usage(program);
+		return 1;
+	}
+
+	if (!tmpl.procs || (!seconds && !tmpl.iterations)) {
+		usage(program);
+		return 1;
+	}
+
+	if (self_bench) {
+		if (tmpl.procs > MAX_PROCESSES) {
+			usage(program);
+			return 1;
+		}
+		return selfbench_run(tmpl.procs, tmpl.block_size, self_bench,
+				tmpl.random, clk_id);
+	}
+
+	no_devices = 0;
+	for (i = optind; argv[i]; i++) {
+		devices = realloc(devices, sizeof(*devices) * (no_devices + 1));
+		if (!devices) {
+			fprintf(stderr, "Memory Allocation Failed.\n");
+			return 1;
+		}
+
+		devices[no_devices] = strdup(argv[i]);
+		no_devices++;
+	}
+
+	if (metadata) {
+		struct stat buf;
+
+		for (i = 0; i < no_devices; i++) {
+			if (stat(devices[i], &buf) < 0 || !S_ISDIR(buf.st_mode)) {
+				fprintf(stderr, "%s is not a directory.\n", devices[i]);
+				usage(program);
+				return 1;
+			}
+		}
+		return md_run(devices, no_devices, tmpl.procs, &md,
+				tmpl.iterations, seconds, clk_id);
+	}
+
+	tmpl.dev_size	= dev_size;
+
+	if (suite) {
+		if (!no_devices || job_file) {
+			usage(program);
+			return 1;
+		}
+		return suite_run(suite, &tmpl, devices, no_devices, seconds,
+				clk_id, suite_json);
+	}
+
+	memset(&run, 0, sizeof(run));
+	if (job_file) {
+		if (no_devices) {
+			fprintf(stderr, "PATHS are given by the job file.\n");
+			return 1;
+		}
+
+		if (jobfile_parse(job_file, &tmpl, &seconds, &run.jobs,
+					&run.no_jobs) < 0)
+			return 1;
+	} else if (stripe_chunk) {
+		/* one job over all paths */
+		run.jobs	= calloc(1, sizeof(*run.jobs));
+		run.no_jobs	= 1;
+		if (!run.jobs) {
+			fprintf(stderr, "Memory Allocation Failed.\n");
+			return 1;
+		}
+
+		run.jobs[0] = tmpl;
+		run.jobs[0].stripe_chunk = stripe_chunk;
+		strcpy(run.jobs[0].name, "stripe");
+		for (i = 0; i < no_devices; i++) {
+			if (strchr(devices[i], STRIPE_SEPARATOR) ||
+					strlen(run.jobs[0].path) + strlen(devices[i]) + 2 >
+					sizeof(run.jobs[0].path)) {
+				fprintf(stderr, "%s can not be striped.\n", devices[i]);
+				return 1;
+			}
+			if (i)
+				strcat(run.jobs[0].path, ",");
+			strcat(run.jobs[0].path, devices[i]);
+		}
+	} else {
+		/* one job for each path */
+		run.jobs	= calloc(no_devices, sizeof(*run.jobs));
+		run.no_jobs	= no_devices;
+		if (!run.jobs) {
+			fprintf(stderr, "Memory Allocation Failed.\n");
+			return 1;
+		}
+
+		for (i = 0; i < no_devices; i++) {
+			run.jobs[i] = tmpl;
+			snprintf(run.jobs[i].path, sizeof(run.jobs[i].path), "%s",
+					devices[i]);
+			snprintf(run.jobs[i].name, sizeof(run.jobs[i].name), "%s",
+					devices[i]);
+		}
+	}
+
+	/* timed runs repeat until the workers are killed */
+	for (i = 0; seconds && i < run.no_jobs; i++)
+		run.jobs[i].iterations = 0;
+
+	run.seconds	= seconds;
+	run.clk_id	= clk_id;
+	run.metrics	= metrics;
+	run.slow_ring_size = slow_ring_size;
+	run.disk_interval = disk_interval;
+	run.cgroup_root	= cgroup_root;
+	run.journal_path = journal;
+	run.journal	= -1;
+
+	if (no_clients)
+		return controller_run(clients, no_clients, &run, policy.token);
+
+	if (run_prepare(&run) < 0) {
+		usage(program);
+		return 1;
+	}
+
+	rc = 0;
+	if (run_start(&run) < 0) {
+		rc = 1;
+		goto error;
+	}
+
+	run_go(&run);
+	if (run_wait(&run) < 0)
+		rc = 1;
+
+	printf("Finished\n");
+
+	run_report(run.jobs, run.no_jobs, run.results);
+	if (run.disks)
+		diskstats_report(run.disks, &run, stdout);
+	qos_report(&run, stdout);
+	cache_report(&run, stdout);
 error:
-	if (shm)
-		shmdt(shm);
-	return 0;
+	run_free(&run);
+	free(run.jobs);
+	metrics_close(metrics);
+	return rc;
 }
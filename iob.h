@@ -0,0 +1,215 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __IOB_H__
+#define __IOB_H__
+
+#include <stddef.h>
+#include <limits.h>
+#include <sys/types.h>
+
+#include "ioengine.h"
+#include "stats.h"
+#include "verify.h"
+#include "breakdown.h"
+
+#define IO_BLOCK_SIZE	4096
+#define MAX_PROCESSES	2048
+#define JOB_NAME_LENGTH	64
+#define MAX_BATCH	1024	/* blocks per --batch submission */
+
+#define SEC_TO_MILLI	(10ULL * 10ULL * 10ULL)
+#define SEC_TO_MICRO	((10ULL * 10ULL * 10ULL) * (SEC_TO_MILLI))
+#define SEC_TO_NS	((10ULL * 10ULL * 10ULL) * (SEC_TO_MICRO))
+
+#undef MIN
+#define MIN(a, b)	((a) > (b) ? (b) : (a))
+
+#undef MAX
+#define MAX(a, b)	((a) > (b) ? (a) : (b))
+
+unsigned long long get_hrtime(int clk_id);
+
+int fill_random_buffer(char *buf, size_t nbytes);
+
+long long null_io_cpu_ns(unsigned long block_size, unsigned long ops,
+		int random, int clk_id);
+
+struct ioengine *get_ioengine(const char *name);
+
+enum verify_mode {
+	VERIFY_NONE,
+	VERIFY_PASS,		/* read everything back after each pass */
+	VERIFY_STRICT,		/* read each write back right away */
+	VERIFY_ASYNC,		/* verifier threads, writers keep going */
+};
+
+enum sync_policy {
+	SYNC_DEFAULT,		/* O_SYNC for buffered IO unless dsync */
+	SYNC_NONE,		/* left to the page cache */
+	SYNC_ALWAYS,		/* O_DSYNC */
+	SYNC_FSYNC,		/* fsync() every sync_every writes */
+	SYNC_FDATASYNC,
+};
+
+/* one workload on one path, run by procs workers */
+struct job {
+	char			name[JOB_NAME_LENGTH];
+	char			path[PATH_MAX];
+	char			engine[IOENGINE_PATH_LENGTH];
+	struct ioengine_options	eo;
+
+	unsigned long long	dev_size;	/* bytes of path to use */
+	unsigned long		block_size;
+	unsigned long		iterations;	/* 0: until killed */
+	int			procs;
+	int			verify;		/* enum verify_mode */
+	int			verifiers;	/* threads per worker, async */
+	unsigned int		verify_queue;	/* records per worker, async */
+	int			random;
+	int			read;		/* read instead of write */
+	int			direct;
+	unsigned long		rate_iops;	/* job wide, 0: no limit */
+
+	unsigned long		thinktime;	/* usec */
+	unsigned long		burst;		/* IOs per burst */
+	unsigned long		burst_interval;	/* usec */
+	unsigned long		duty_on;	/* usec */
+	unsigned long		duty_off;	/* usec */
+
+	unsigned long long	slow_threshold;	/* ns, 0: do not log slow IOs */
+	int			lat_breakdown;	/* split latency, see breakdown.c */
+
+	/* QoS, see qos.c */
+	unsigned long long	io_max[4];	/* cgroup io.max, 0: no limit */
+	unsigned int		io_weight;	/* cgroup io.weight, 0: default */
+	int			ioprio;		/* ioprio_set() value, 0: inherit */
+
+	unsigned long		stripe_chunk;	/* bytes, 0: path is not striped */
+	unsigned long		offset_align;	/* bytes, 0: the block size */
+	int			sync_policy;	/* enum sync_policy */
+	unsigned int		sync_every;	/* writes per fsync */
+
+	/* page cache, buffered IO only */
+	int			fadvise;	/* POSIX_FADV_*, -1: no hint */
+	unsigned long		readahead;	/* bytes kept ahead of reads */
+	int			drop_cache;	/* before the run */
+	unsigned int		cache_sample;	/* 1 in n reads, 0: none */
+
+	/* detected by job_prepare(), largest over the stripe members */
+	unsigned int		logical_block_size;
+	unsigned int		physical_block_size;
+	unsigned int		optimal_io_size; /* 0: not reported */
+
+	int			dev_index;	/* jobs on the same path share it */
+};
+
+struct result_data {
+	unsigned long long	total_write_latency;
+	unsigned long long	total_read_latency;
+
+	unsigned long		writes;
+	unsigned long		reads;
+
+	unsigned long long	start_ns;	/* worker's first IO issued */
+	unsigned long long	end_ns;		/* worker's last IO completed */
+
+	struct lat_hist		write_hist;	/* per IO, a batch split evenly */
+	struct lat_hist		read_hist;
+	struct lat_hist		batch_hist;	/* whole --batch submissions */
+	struct lat_hist		burst_hist;	/* IOs issued within bursts */
+	struct lat_hist		quiet_hist;	/* IOs issued between bursts */
+	struct lat_hist		aligned_hist;	/* to the physical block size */
+	struct lat_hist		unaligned_hist;
+	struct lat_hist		sync_hist;	/* fsync policies */
+	unsigned long long	acked;		/* journaled, durability runs */
+
+	struct lat_breakdown	breakdown;	/* lat_breakdown jobs only */
+	struct engine_stats	engine;		/* engine specific counters */
+	struct verify_stats	verify;		/* async verify only */
+
+	unsigned long long	cache_samples;	/* reads checked with mincore() */
+	unsigned long long	cache_hits;	/* ... found in the page cache */
+
+	/* input parameters for calculating result */
+	int			job_index;
+};
+
+struct metrics;
+struct slow_ring;
+struct diskstats;
+struct qos;
+struct cache_state;
+
+/* all jobs of one invocation, started together */
+struct run {
+	struct job		*jobs;
+	int			no_jobs;
+	unsigned long		seconds;	/* 0: run all iterations */
+	int			clk_id;
+	int			quiet;		/* no per job banner */
+
+	struct result_data	*results;	/* shared, job by job */
+	int			no_results;
+	pid_t			*pids;
+	int			no_pids;
+	int			barrier[2];	/* workers start on EOF */
+
+	struct metrics		*metrics;	/* live export, may be NULL */
+
+	unsigned int		slow_ring_size;	/* slow IO log entries */
+	struct slow_ring	*slow;		/* shared, NULL if not logging */
+	unsigned int		*inflight;	/* shared, by job dev_index */
+	unsigned long long	clock_start;	/* clk_id time at run_go() */
+	unsigned long long	wall_start;	/* CLOCK_REALTIME at run_go() */
+
+	unsigned long long	disk_interval;	/* ns, 0: block stats at end only */
+	struct diskstats	*disks;
+
+	const char		*cgroup_root;	/* NULL: cgroup v2 mount */
+	struct qos		*qos;		/* job cgroups, may be NULL */
+	struct cache_state	*cache;		/* by job, at start and end */
+
+	const char		*journal_path;	/* NULL: no durability run */
+	int			journal;	/* fd, inherited by workers */
+	uint64_t		run_id;		/* stamped into every block */
+};
+
+int run_prepare(struct run *r);
+
+int run_start(struct run *r);
+
+void run_go(struct run *r);
+
+int run_wait(struct run *r);
+
+void run_abort(struct run *r);
+
+void run_report(struct job *jobs, int no_jobs, struct result_data *results);
+
+void run_free(struct run *r);
+
+void *alloc_shared(size_t size);
+void free_shared(void *addr);
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Interface of IO engines built as shared objects and loaded with
+ * -E ./engine.so. The plugin exports
+ *
+ *	const struct iob_plugin *iob_plugin_register(void);
+ *
+ * returning its description. Workers are processes; each worker that
+ * uses the plugin calls init() once, then open() for its range of the
+ * target, submits and reaps IOs and finally calls close() and teardown().
+ * The parent process also calls init() and teardown() to check the
+ * options before any worker is started.
+ *
+ * Plugins include only this header. The ABI major version changes when
+ * existing fields change; new fields are appended at the end, bumping the
+ * minor version, and iob does not use fields beyond the size the plugin
+ * was built with.
+ */
+
+#ifndef __IOB_PLUGIN_H__
+#define __IOB_PLUGIN_H__
+
+#define IOB_PLUGIN_ABI_MAJOR	1
+#define IOB_PLUGIN_ABI_MINOR	1
+#define IOB_PLUGIN_ABI		((IOB_PLUGIN_ABI_MAJOR << 16) | IOB_PLUGIN_ABI_MINOR)
+
+#define IOB_PLUGIN_SYMBOL	"iob_plugin_register"
+#define IOB_PLUGIN_STATS	4
+
+/* engine specific options, -O key=value */
+struct iob_option {
+	const char	*key;
+	const char	*value;
+};
+
+/* what a worker works on */
+struct iob_target {
+	const char		*path;
+	int			fd;		/* opened by iob, may be ignored */
+	unsigned long long	offset;		/* bytes, start of the range */
+	unsigned long long	length;		/* bytes */
+	unsigned long		block_size;
+	unsigned int		depth;		/* most IOs iob keeps in flight */
+	int			direct;		/* fd is O_DIRECT */
+
+	/* counters named by stat_names, shared with iob, update live */
+	unsigned long long	*stats;
+
+	int			clock_id;	/* of issue_ns and complete_ns */
+};
+
+struct iob_io {
+	/* set by iob before submit */
+	void			*buf;
+	unsigned long long	offset;		/* bytes */
+	unsigned long		length;
+	int			write;
+
+	/* set by the plugin on completion: bytes transferred or -errno */
+	long			result;
+
+	void			*engine_data;	/* free for the plugin */
+	unsigned long long	issue_ns;	/* owned by iob */
+
+	/*
+	 * optional: clock_id time the plugin saw the IO complete, tells the
+	 * device time from the reap delay. iob zeroes it before submit.
+	 */
+	unsigned long long	complete_ns;
+};
+
+struct iob_plugin {
+	unsigned int	abi;			/* IOB_PLUGIN_ABI */
+	unsigned int	size;			/* sizeof(struct iob_plugin) */
+	const char	*name;
+	unsigned int	max_depth;		/* most IOs in flight, 1: none queued */
+	const char	*stat_names[IOB_PLUGIN_STATS];
+
+	/* optional: process wide setup, -EINVAL for unknown options */
+	int (*init)(const struct iob_option *opts, int nr);
+	/* optional */
+	void (*teardown)(void);
+
+	int (*open)(void **data, const struct iob_target *target);
+	void (*close)(void *data);
+
+	/* optional: buffers iob will use for IO, called once after open() */
+	int (*register_buffers)(void *data, void **bufs, unsigned int nr,
+			unsigned long size);
+
+	/*
+	 * Queues up to nr IOs, returns how many were accepted or -errno.
+	 * reap() waits until at least min IOs completed and stores up to max
+	 * of them in ios, returns their number or -errno.
+	 */
+	int (*submit)(void *data, struct iob_io **ios, unsigned int nr);
+	int (*reap)(void *data, struct iob_io **ios, unsigned int min,
+			unsigned int max);
+};
+
+const struct iob_plugin *iob_plugin_register(void);
+
+#endif
@@ -24,14 +24,89 @@
 #ifndef __IOENGINE_H__
 #define __IOENGINE_H__
 
+#include "iob_plugin.h"
+
 #define IOENGIN_NAME_LENGTH 8
+#define IOENGINE_PATH_LENGTH 256	/* engine name or plugin path */
+#define IOENGINE_OPTS_LENGTH 256
+#define ENGINE_STATS	IOB_PLUGIN_STATS
+
+/* options common to all engines, engines ignore what they do not support */
+struct ioengine_options {
+	int		hipri;		/* polled completion */
+	int		nowait;		/* fail instead of blocking */
+	int		dsync;		/* per IO data sync */
+	unsigned int	batch;		/* max blocks per submission */
+	int		populate;	/* prefault mappings */
+	int		advice;		/* madvise() advice, -1 for none */
+	int		hugepage;	/* huge page backed mappings */
+	unsigned int	depth;		/* IOs in flight, queued engines */
+	char		opts[IOENGINE_OPTS_LENGTH]; /* key=value,... plugins */
+
+	/* filled in from the job before init() */
+	const char	*path;
+	unsigned long	block_size;
+	int		direct;
+	int		clk_id;		/* latency clock of the run */
+	int		sync_policy;	/* enum sync_policy of writes */
+};
+
+/* engine specific counters, named by ioengine.stat_names */
+struct engine_stats {
+	unsigned long long	val[ENGINE_STATS];
+};
 
 struct ioengine {
 	char name[IOENGIN_NAME_LENGTH + 1];
+
+	/*
+	 * optional: called once before workers are started and again in each
+	 * worker before open()
+	 */
+	int (*init)(struct ioengine *engine, struct ioengine_options *o);
+
+	/*
+	 * optional: called in each worker before it issues IO, the worker
+	 * only touches [offset, offset + length) of the file
+	 */
+	int (*open)(int fd, unsigned long long offset, unsigned long long length,
+			struct engine_stats *stats);
+
+	/* optional: called in each worker after the last IO */
+	void (*close)(int fd);
+
 	int (*read_block)(int fd, void *buf, unsigned long block,
 			unsigned long block_size);
 	int (*write_block)(int fd, void *buf, unsigned long block,
 			unsigned long block_size);
+
+	/* optional: IO of any length at any byte offset, see offset_align */
+	int (*read_at)(int fd, void *buf, unsigned long long offset,
+			unsigned long length);
+	int (*write_at)(int fd, void *buf, unsigned long long offset,
+			unsigned long length);
+
+	/* optional: write buf to each of nr blocks with as few calls as possible */
+	int (*write_blocks)(int fd, void *buf, unsigned long *blocks, int nr,
+			unsigned long block_size);
+
+	/* optional: makes written data durable, instead of fsync() */
+	int (*sync)(int fd, int data_only);
+
+	/*
+	 * optional: queued IO with up to max_depth IOs in flight, see
+	 * struct iob_plugin for the semantics
+	 */
+	unsigned int max_depth;
+	int (*register_buffers)(int fd, void **bufs, unsigned int nr,
+			unsigned long size);
+	int (*submit)(int fd, struct iob_io **ios, unsigned int nr);
+	int (*reap)(int fd, struct iob_io **ios, unsigned int min,
+			unsigned int max);
+
+	const char *stat_names[ENGINE_STATS];
 };
 
+struct ioengine *plugin_load(const char *path);
+
 #endif
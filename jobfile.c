@@ -0,0 +1,498 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * INI style job files:
+ *
+ *	[global]
+ *	runtime=60
+ *	engine=pvsync2
+ *
+ *	[reader]
+ *	filename=/dev/sdb
+ *	rw=randread
+ *	bs=4k
+ *	rate_iops=2000
+ *
+ *	[writer]
+ *	filename=/dev/sdb
+ *	rw=write
+ *	bs=1m
+ *	workers=2
+ *
+ *	[raid0]
+ *	filename=/dev/sdc,/dev/sdd
+ *	stripe=64k
+ *
+ * Keys in [global] are defaults for the jobs following it; the command line
+ * options are the defaults of [global]. Lines starting with '#' or ';' are
+ * comments.
+ *
+ * Sizes take a k, m, g or t suffix; size= is in GB without one, like -S.
+ * Counts such as workers, iterations, batch or iodepth are plain decimals.
+ * thinktime, burst_interval, duty_on, duty_off and slow_threshold take a
+ * ns, us, ms or s suffix and are in microseconds without one. runtime is
+ * whole seconds, with or without an s suffix.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <errno.h>
+
+#include "iob.h"
+#include "jobfile.h"
+#include "qos.h"
+#include "cache.h"
+#include "durability.h"
+
+int parse_size(const char *str, unsigned long long *size)
+{
+	unsigned long long	v;
+	char			*end;
+
+	errno = 0;
+	v = strtoull(str, &end, 10);
+	if (errno || end == str)
+		return -1;
+
+	switch (tolower(*end)) {
+	case 't':
+		v <<= 10;
+		/* fall through */
+	case 'g':
+		v <<= 10;
+		/* fall through */
+	case 'm':
+		v <<= 10;
+		/* fall through */
+	case 'k':
+		v <<= 10;
+		end++;
+		break;
+	case 0:
+		break;
+	default:
+		return -1;
+	}
+
+	if (tolower(*end) == 'b')
+		end++;
+	if (*end)
+		return -1;
+
+	*size = v;
+	return 0;
+}
+
+/* decimal count between min and max, no unit suffix */
+int parse_count(const char *str, unsigned long long min,
+		unsigned long long max, unsigned long long *v)
+{
+	char	*end;
+
+	errno = 0;
+	*v = strtoull(str, &end, 10);
+	if (errno || end == str || *end || *str == '-' ||
+			*v < min || *v > max)
+		return -1;
+	return 0;
+}
+
+/* size of the path to use, GB unless a unit is given */
+int parse_dev_size(const char *str, unsigned long long *size)
+{
+	if (parse_size(str, size) < 0)
+		return -1;
+	if (str[strspn(str, "0123456789")] == 0)
+		*size *= 1024ULL * 1024ULL * 1024ULL;
+	return 0;
+}
+
+/* time with a ns, us, ms or s suffix, microseconds without one */
+int parse_time(const char *str, unsigned long long *ns)
+{
+	unsigned long long	v;
+	char			*end;
+
+	errno = 0;
+	v = strtoull(str, &end, 10);
+	if (errno || end == str)
+		return -1;
+
+	if (!strcmp(end, "ns"))
+		*ns = v;
+	else if (!*end || !strcmp(end, "us"))
+		*ns = v * 1000ULL;
+	else if (!strcmp(end, "ms"))
+		*ns = v * 1000ULL * 1000ULL;
+	else if (!strcmp(end, "s"))
+		*ns = v * 1000ULL * 1000ULL * 1000ULL;
+	else
+		return -1;
+	return 0;
+}
+
+int parse_bool(const char *str, int *val)
+{
+	if (!strcmp(str, "1") || !strcasecmp(str, "yes") ||
+			!strcasecmp(str, "true")) {
+		*val = 1;
+		return 0;
+	}
+
+	if (!strcmp(str, "0") || !strcasecmp(str, "no") ||
+			!strcasecmp(str, "false")) {
+		*val = 0;
+		return 0;
+	}
+	return -1;
+}
+
+int parse_rw(const char *str, struct job *job)
+{
+	if (!strcmp(str, "write")) {
+		job->read   = 0;
+		job->random = 0;
+	} else if (!strcmp(str, "randwrite")) {
+		job->read   = 0;
+		job->random = 1;
+	} else if (!strcmp(str, "read")) {
+		job->read   = 1;
+		job->random = 0;
+	} else if (!strcmp(str, "randread")) {
+		job->read   = 1;
+		job->random = 1;
+	} else {
+		return -1;
+	}
+	return 0;
+}
+
+/* pass, strict or async; booleans turn pass mode on or off */
+int parse_verify(const char *str, int *mode)
+{
+	int b;
+
+	if (!strcmp(str, "pass"))
+		*mode = VERIFY_PASS;
+	else if (!strcmp(str, "strict"))
+		*mode = VERIFY_STRICT;
+	else if (!strcmp(str, "async"))
+		*mode = VERIFY_ASYNC;
+	else if (!parse_bool(str, &b))
+		*mode = b ? VERIFY_PASS : VERIFY_NONE;
+	else
+		return -1;
+	return 0;
+}
+
+char *ini_strip(char *s)
+{
+	char *e;
+
+	while (isspace((unsigned char) *s))
+		s++;
+
+	e = s + strlen(s);
+	while (e > s && isspace((unsigned char) e[-1]))
+		*--e = 0;
+	return s;
+}
+
+static int set_string(char *dst, size_t len, const char *val)
+{
+	if (strlen(val) >= len)
+		return -1;
+	strcpy(dst, val);
+	return 0;
+}
+
+/* applies key=value to job, seconds is only settable in [global] */
+/* keys taking a plain count and the values each accepts */
+static const struct {
+	const char		*key;
+	unsigned long long	min, max;
+} count_keys[] = {
+	{ "workers",		1, MAX_PROCESSES },
+	{ "numjobs",		1, MAX_PROCESSES },
+	{ "iterations",		0, ULONG_MAX },
+	{ "rate_iops",		0, ULONG_MAX },
+	{ "batch",		1, MAX_BATCH },
+	{ "burst",		0, ULONG_MAX },
+	{ "cache_sample",	0, UINT_MAX },
+	{ "io_weight",		1, 10000 },
+	{ "iodepth",		1, UINT_MAX },
+	{ "verifiers",		0, INT_MAX },
+	{ "verify_queue",	0, UINT_MAX },
+};
+
+static int job_set(struct job *job, unsigned long *seconds, const char *key,
+		const char *val)
+{
+	unsigned long long	v;
+	int			b;
+	size_t			i;
+
+	if (!strcmp(key, "filename") || !strcmp(key, "target"))
+		return set_string(job->path, sizeof(job->path), val);
+
+	if (!strcmp(key, "engine") || !strcmp(key, "ioengine")) {
+		if (!get_ioengine(val))
+			return -1;
+		return set_string(job->engine, sizeof(job->engine), val);
+	}
+
+	if (!strcmp(key, "rw"))
+		return parse_rw(val, job);
+
+	if (!strcmp(key, "io_max"))
+		return parse_io_max(val, job);
+
+	if (!strcmp(key, "fadvise"))
+		return parse_fadvise(val, &job->fadvise);
+
+	if (!strcmp(key, "drop_cache"))
+		return parse_bool(val, &job->drop_cache);
+
+	if (!strcmp(key, "ioprio"))
+		return parse_ioprio(val, &job->ioprio);
+
+	if (!strcmp(key, "engine_options"))
+		return set_string(job->eo.opts, sizeof(job->eo.opts), val);
+
+	if (!strcmp(key, "runtime") || !strcmp(key, "seconds")) {
+		if (!seconds)
+			return -1;
+		if (val[strspn(val, "0123456789")] == 0) {
+			if (parse_size(val, &v) < 0)
+				return -1;
+		} else {
+			if (parse_time(val, &v) < 0 || v % SEC_TO_NS)
+				return -1;
+			v /= SEC_TO_NS;
+		}
+		*seconds = v;
+		return 0;
+	}
+
+	if (!strcmp(key, "size"))
+		return parse_dev_size(val, &job->dev_size);
+
+	/* the pacer takes microseconds */
+	if (!strcmp(key, "thinktime") || !strcmp(key, "burst_interval") ||
+			!strcmp(key, "duty_on") || !strcmp(key, "duty_off")) {
+		if (parse_time(val, &v) < 0)
+			return -1;
+		v /= SEC_TO_NS / SEC_TO_MICRO;
+
+		if (!strcmp(key, "thinktime"))
+			job->thinktime = v;
+		else if (!strcmp(key, "burst_interval"))
+			job->burst_interval = v;
+		else if (!strcmp(key, "duty_on"))
+			job->duty_on = v;
+		else
+			job->duty_off = v;
+		return 0;
+	}
+
+	if (!strcmp(key, "verify"))
+		return parse_verify(val, &job->verify);
+
+	if (!strcmp(key, "sync"))
+		return parse_sync(val, &job->sync_policy, &job->sync_every);
+
+	if (!strcmp(key, "lat_breakdown"))
+		return parse_bool(val, &job->lat_breakdown);
+
+	if (!strcmp(key, "slow_threshold"))
+		return parse_time(val, &job->slow_threshold);
+
+	if (!strcmp(key, "direct") || !strcmp(key, "hipri") || !strcmp(key, "nowait") ||
+			!strcmp(key, "dsync")) {
+		if (parse_bool(val, &b) < 0)
+			return -1;
+
+		if (!strcmp(key, "direct"))
+			job->direct = b;
+		else if (!strcmp(key, "hipri"))
+			job->eo.hipri = b;
+		else if (!strcmp(key, "nowait"))
+			job->eo.nowait = b;
+		else
+			job->eo.dsync = b;
+		return 0;
+	}
+
+	/* counts take no unit suffix, 4k workers is a typo */
+	for (i = 0; i < sizeof(count_keys) / sizeof(count_keys[0]); i++)
+		if (!strcmp(key, count_keys[i].key))
+			break;
+	if (i < sizeof(count_keys) / sizeof(count_keys[0])) {
+		if (parse_count(val, count_keys[i].min, count_keys[i].max,
+					&v) < 0)
+			return -1;
+
+		if (!strcmp(key, "workers") || !strcmp(key, "numjobs"))
+			job->procs = v;
+		else if (!strcmp(key, "iterations"))
+			job->iterations = v;
+		else if (!strcmp(key, "rate_iops"))
+			job->rate_iops = v;
+		else if (!strcmp(key, "batch"))
+			job->eo.batch = v;
+		else if (!strcmp(key, "burst"))
+			job->burst = v;
+		else if (!strcmp(key, "cache_sample"))
+			job->cache_sample = v;
+		else if (!strcmp(key, "io_weight"))
+			job->io_weight = v;
+		else if (!strcmp(key, "iodepth"))
+			job->eo.depth = v;
+		else if (!strcmp(key, "verifiers"))
+			job->verifiers = v;
+		else
+			job->verify_queue = v;
+		return 0;
+	}
+
+	if (parse_size(val, &v) < 0)
+		return -1;
+
+	if (!strcmp(key, "bs") || !strcmp(key, "block_size"))
+		job->block_size = v;
+	else if (!strcmp(key, "readahead"))
+		job->readahead = v;
+	else if (!strcmp(key, "offset_align"))
+		job->offset_align = v;
+	else if (!strcmp(key, "stripe"))
+		job->stripe_chunk = v;
+	else
+		return -1;
+	return 0;
+}
+
+int jobfile_parse(const char *path, const struct job *defaults,
+		unsigned long *seconds, struct job **jobs, int *no_jobs)
+{
+	FILE		*fp;
+	char		line[PATH_MAX + 64];
+	char		*s, *key, *val;
+	struct job	global;
+	struct job	*job;	/* section being parsed, NULL for [global] */
+	struct job	*j;
+	int		lineno;
+	int		n;
+
+	fp = fopen(path, "r");
+	if (!fp) {
+		fprintf(stderr, "open(%s) failed: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	global = *defaults;
+	job    = NULL;
+	lineno = 0;
+	n      = 0;
+	*jobs  = NULL;
+
+	while (fgets(line, sizeof(line), fp)) {
+		lineno++;
+		s = ini_strip(line);
+		if (!*s || *s == '#' || *s == ';')
+			continue;
+
+		if (*s == '[') {
+			val = strchr(s, ']');
+			if (!val)
+				goto syntax;
+			*val = 0;
+			s = ini_strip(s + 1);
+
+			if (!strcmp(s, "global")) {
+				if (n) {
+					fprintf(stderr, "%s:%d: [global] must come "
+						"before the jobs\n", path, lineno);
+					goto error;
+				}
+				job = NULL;
+				continue;
+			}
+
+			j = realloc(*jobs, sizeof(**jobs) * (n + 1));
+			if (!j) {
+				fprintf(stderr, "Memory Allocation Failed.\n");
+				goto error;
+			}
+			*jobs = j;
+			job   = &j[n++];
+			*job  = global;
+			if (set_string(job->name, sizeof(job->name), s) < 0)
+				goto syntax;
+			continue;
+		}
+
+		val = strchr(s, '=');
+		if (!val)
+			goto syntax;
+		*val = 0;
+		key  = ini_strip(s);
+		val  = ini_strip(val + 1);
+
+		if (job_set(job ? job : &global, job ? NULL : seconds,
+					key, val) < 0) {
+			fprintf(stderr, "%s:%d: invalid %s = %s\n", path, lineno,
+					key, val);
+			goto error;
+		}
+	}
+	fclose(fp);
+
+	for (j = *jobs; j < *jobs + n; j++) {
+		if (!j->path[0]) {
+			fprintf(stderr, "%s: job %s has no filename\n", path,
+					j->name);
+			free(*jobs);
+			*jobs = NULL;
+			return -1;
+		}
+	}
+
+	if (!n) {
+		fprintf(stderr, "%s: no jobs defined\n", path);
+		return -1;
+	}
+
+	*no_jobs = n;
+	return 0;
+
+syntax:
+	fprintf(stderr, "%s:%d: syntax error\n", path, lineno);
+error:
+	fclose(fp);
+	free(*jobs);
+	*jobs = NULL;
+	return -1;
+}
@@ -0,0 +1,49 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __JOBFILE_H__
+#define __JOBFILE_H__
+
+#include "iob.h"
+
+char *ini_strip(char *s);
+
+int parse_size(const char *str, unsigned long long *size);
+
+int parse_count(const char *str, unsigned long long min,
+		unsigned long long max, unsigned long long *v);
+
+int parse_dev_size(const char *str, unsigned long long *size);
+
+int parse_time(const char *str, unsigned long long *ns);
+
+int parse_bool(const char *str, int *val);
+
+int parse_rw(const char *str, struct job *job);
+
+int parse_verify(const char *str, int *mode);
+
+int jobfile_parse(const char *path, const struct job *defaults,
+		unsigned long *seconds, struct job **jobs, int *no_jobs);
+
+#endif
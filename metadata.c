@@ -0,0 +1,381 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#define _GNU_SOURCE
+#define _LARGEFILE64_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "iob.h"
+#include "metadata.h"
+
+static const char *md_op_names[MD_OPS] = {
+	[MD_CREATE]	= "create",
+	[MD_STAT]	= "stat",
+	[MD_RENAME]	= "rename",
+	[MD_UNLINK]	= "unlink",
+};
+
+struct md_worker {
+	struct md_params	*p;
+	struct md_result	*r;
+	int			clk_id;
+	time_t			deadline;	/* 0: run by iterations */
+	char			*buf;		/* file contents */
+	char			path[PATH_MAX];
+	char			path2[PATH_MAX];
+};
+
+static int md_mkdir_tree(char *path, size_t len, unsigned int level,
+		struct md_params *p)
+{
+	unsigned int	i;
+	int		n;
+
+	if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+		fprintf(stderr, "mkdir(%s) failed: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	if (level == p->depth)
+		return 0;
+
+	for (i = 0; i < p->fanout; i++) {
+		n = snprintf(path + len, PATH_MAX - len, "/d%u", i);
+		if (n >= PATH_MAX - len)
+			return -1;
+		if (md_mkdir_tree(path, len + n, level + 1, p) < 0)
+			return -1;
+	}
+	path[len] = 0;
+	return 0;
+}
+
+static void md_rmdir_tree(char *path, size_t len, unsigned int level,
+		struct md_params *p)
+{
+	unsigned int	i;
+	int		n;
+
+	if (level < p->depth) {
+		for (i = 0; i < p->fanout; i++) {
+			n = snprintf(path + len, PATH_MAX - len, "/d%u", i);
+			md_rmdir_tree(path, len + n, level + 1, p);
+		}
+		path[len] = 0;
+	}
+	rmdir(path);
+}
+
+/* appends the directory components of leaf to path, returns new length */
+static size_t md_leaf_path(char *path, size_t len, unsigned long leaf,
+		struct md_params *p)
+{
+	unsigned long	div;
+	unsigned int	i;
+
+	div = 1;
+	for (i = 1; i < p->depth; i++)
+		div *= p->fanout;
+
+	for (i = 0; i < p->depth; i++) {
+		len += snprintf(path + len, PATH_MAX - len, "/d%lu",
+				(leaf / div) % p->fanout);
+		div /= p->fanout ? p->fanout : 1;
+		if (!div)
+			div = 1;
+	}
+	return len;
+}
+
+static int md_do_op(struct md_worker *w, enum md_op op)
+{
+	struct stat	st;
+	ssize_t		rc;
+	unsigned long	remaining;
+	int		fd;
+
+	switch (op) {
+	case MD_CREATE:
+		fd = open(w->path, O_CREAT | O_EXCL | O_WRONLY, 0644);
+		if (fd < 0)
+			break;
+		remaining = w->p->file_size;
+		while (remaining > 0) {
+			rc = write(fd, w->buf, remaining);
+			if (rc < 0) {
+				if (errno == EINTR)
+					continue;
+				close(fd);
+				return -1;
+			}
+			remaining -= rc;
+		}
+		return close(fd);
+	case MD_STAT:
+		return stat(w->path, &st);
+	case MD_RENAME:
+		return rename(w->path, w->path2);
+	case MD_UNLINK:
+		return unlink(w->path2);
+	default:
+		break;
+	}
+	return -1;
+}
+
+static int md_phase(struct md_worker *w, enum md_op op, size_t root_len,
+		unsigned long leaves)
+{
+	struct md_params	*p = w->p;
+	struct lat_hist		*h = &w->r->hist[op];
+	unsigned long		leaf;
+	unsigned int		f;
+	size_t			len;
+	unsigned long long	start, s, e;
+
+	start = get_hrtime(w->clk_id);
+	for (leaf = 0; leaf < leaves; leaf++) {
+		len = md_leaf_path(w->path, root_len, leaf, p);
+		memcpy(w->path2, w->path, len);
+
+		for (f = 0; f < p->files; f++) {
+			if (w->deadline && time(NULL) >= w->deadline) {
+				w->r->elapsed[op] += get_hrtime(w->clk_id) -
+					start;
+				return 1;
+			}
+
+			snprintf(w->path + len, PATH_MAX - len, "/f%u", f);
+			snprintf(w->path2 + len, PATH_MAX - len, "/r%u", f);
+
+			s = get_hrtime(w->clk_id);
+			if (md_do_op(w, op) < 0) {
+				fprintf(stderr, "%s(%s) failed: %s\n",
+					md_op_names[op], w->path,
+					strerror(errno));
+				return -1;
+			}
+			e = get_hrtime(w->clk_id);
+			lat_hist_add(h, e - s);
+		}
+	}
+	w->r->elapsed[op] += get_hrtime(w->clk_id) - start;
+	return 0;
+}
+
+/* removes the files a pass cut short by the deadline left behind */
+static void md_clean(struct md_worker *w, size_t root_len,
+		unsigned long leaves)
+{
+	unsigned long	leaf;
+	unsigned int	f;
+	size_t		len;
+
+	for (leaf = 0; leaf < leaves; leaf++) {
+		len = md_leaf_path(w->path, root_len, leaf, w->p);
+		for (f = 0; f < w->p->files; f++) {
+			snprintf(w->path + len, PATH_MAX - len, "/f%u", f);
+			unlink(w->path);
+			snprintf(w->path + len, PATH_MAX - len, "/r%u", f);
+			unlink(w->path);
+		}
+	}
+}
+
+static int md_worker(const char *root, int worker, struct md_params *p,
+		unsigned long iterations, unsigned long seconds, int clk_id,
+		struct md_result *r)
+{
+	struct md_worker	w;
+	unsigned long		leaves;
+	unsigned int		i;
+	size_t			root_len;
+	time_t			deadline;
+	int			op;
+	int			rc;
+
+	memset(&w, 0, sizeof(w));
+	w.p      = p;
+	w.r      = r;
+	w.clk_id = clk_id;
+	w.buf    = malloc(p->file_size ? p->file_size : 1);
+	if (!w.buf) {
+		fprintf(stderr, "Memory Allocation Failed.\n");
+		return -1;
+	}
+	memset(w.buf, 0xa5, p->file_size);
+
+	leaves = 1;
+	for (i = 0; i < p->depth; i++)
+		leaves *= p->fanout;
+
+	root_len = snprintf(w.path, PATH_MAX, "%s/iob-md.%d", root, worker);
+	if (root_len >= PATH_MAX || md_mkdir_tree(w.path, root_len, 0, p) < 0) {
+		free(w.buf);
+		return -1;
+	}
+
+	for (op = 0; op < MD_OPS; op++)
+		lat_hist_init(&r->hist[op]);
+
+	rc         = 0;
+	w.deadline = seconds ? time(NULL) + seconds : 0;
+	while (seconds ? time(NULL) < w.deadline : iterations--) {
+		for (op = 0; op < MD_OPS; op++) {
+			rc = md_phase(&w, op, root_len, leaves);
+			if (rc < 0)
+				goto out;
+			if (rc) {
+				md_clean(&w, root_len, leaves);
+				rc = 0;
+				goto out;
+			}
+		}
+	}
+
+out:
+	w.path[root_len] = 0;
+	md_rmdir_tree(w.path, root_len, 0, p);
+	free(w.buf);
+	return rc;
+}
+
+static void md_report(char **paths, int no_paths, int procs,
+		struct md_result *results)
+{
+	struct lat_hist		h;
+	struct md_result	*r;
+	double			ops_sec;
+	int			d, i, op;
+
+	for (d = 0; d < no_paths; d++) {
+		printf("\n\nPath = %s\n", paths[d]);
+
+		for (op = 0; op < MD_OPS; op++) {
+			lat_hist_init(&h);
+			ops_sec = 0;
+
+			for (i = 0; i < procs; i++) {
+				r = &results[d * procs + i];
+				lat_hist_merge(&h, &r->hist[op]);
+				if (r->elapsed[op])
+					ops_sec += (double) r->hist[op].count *
+						SEC_TO_NS / r->elapsed[op];
+			}
+
+			printf("%-8s: ops = %llu, ops/s = %.0f\n",
+					md_op_names[op], h.count, ops_sec);
+			lat_hist_print(md_op_names[op], &h);
+		}
+	}
+}
+
+int md_run(char **paths, int no_paths, int procs, struct md_params *p,
+		unsigned long iterations, unsigned long seconds, int clk_id)
+{
+	struct md_result	*results;
+	pid_t			*pids;
+	pid_t			pid;
+	unsigned long		leaves;
+	int			d, i, n;
+	int			status;
+	int			failed;
+
+	if (!p->fanout && p->depth) {
+		fprintf(stderr, "Directory fan-out must be at least 1.\n");
+		return 1;
+	}
+
+	for (leaves = 1, i = 0; i < p->depth; i++) {
+		leaves *= p->fanout;
+		if (leaves > MD_MAX_LEAVES) {
+			fprintf(stderr, "Fan-out %u to depth %u is more than "
+					"%lu leaf directories.\n", p->fanout,
+					p->depth, MD_MAX_LEAVES);
+			return 1;
+		}
+	}
+
+	results = alloc_shared(sizeof(*results) * no_paths * procs);
+	pids    = calloc(no_paths * procs, sizeof(*pids));
+	if (!results || !pids) {
+		fprintf(stderr, "Memory Allocation Failed.\n");
+		return 1;
+	}
+
+	printf("Directory Depth = %u\n", p->depth);
+	printf("Directory Fan-out = %u\n", p->fanout);
+	printf("Files Per Directory = %u\n", p->files);
+	printf("File Size = %lu\n", p->file_size);
+	fflush(stdout);
+
+	n = 0;
+	for (d = 0; d < no_paths; d++) {
+		for (i = 0; i < procs; i++) {
+			pid = fork();
+			if (pid < 0) {
+				fprintf(stderr, "fork failed: %s\n", strerror(errno));
+				break;
+			} else if (pid) {
+				pids[n++] = pid;
+				continue;
+			}
+
+			/* child process */
+			results[d * procs + i].device_index = d;
+			exit(md_worker(paths[d], i, p, iterations, seconds,
+					clk_id, &results[d * procs + i]) ? 1 : 0);
+		}
+	}
+
+	failed = 0;
+	for (i = 0; i < n; i++) {
+		waitpid(pids[i], &status, 0);
+		if (!WIFEXITED(status) || WEXITSTATUS(status))
+			failed = 1;
+	}
+
+	printf("Finished\n");
+	if (failed)
+		fprintf(stderr, "Some metadata workers failed.\n");
+
+	md_report(paths, no_paths, procs, results);
+
+	free(pids);
+	free_shared(results);
+	return failed;
+}
@@ -0,0 +1,60 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __METADATA_H__
+#define __METADATA_H__
+
+#include "stats.h"
+
+enum md_op {
+	MD_CREATE,
+	MD_STAT,
+	MD_RENAME,
+	MD_UNLINK,
+	MD_OPS,
+};
+
+/* fanout^depth leaf directories per worker, at most MD_MAX_LEAVES */
+#define MD_MAX_DEPTH		16
+#define MD_MAX_FANOUT		4096
+#define MD_MAX_LEAVES		(1UL << 20)
+#define MD_MAX_FILE_SIZE	(1ULL << 30)	/* one buffer of it per worker */
+
+struct md_params {
+	unsigned int	depth;		/* directory levels below worker root */
+	unsigned int	fanout;		/* sub directories per directory */
+	unsigned int	files;		/* files in each leaf directory */
+	unsigned long	file_size;	/* bytes written to each new file */
+};
+
+struct md_result {
+	struct lat_hist		hist[MD_OPS];
+	unsigned long long	elapsed[MD_OPS];	/* ns spent in each phase */
+
+	int			device_index;
+};
+
+int md_run(char **paths, int no_paths, int procs, struct md_params *p,
+		unsigned long iterations, unsigned long seconds, int clk_id);
+
+#endif
@@ -0,0 +1,349 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "iob.h"
+#include "net.h"
+#include "metrics.h"
+
+/*
+ * Workers only ever store to their own result_data and nothing here takes
+ * a lock or writes to shared memory, so a scrape never stalls the IO path.
+ * Values are loaded one at a time; a scrape racing with a worker may see
+ * buckets a few IOs ahead of the sum. Histogram counts are summed from the
+ * loaded buckets, so +Inf and _count always match the last bucket.
+ */
+#define LOAD(x)		__atomic_load_n(&(x), __ATOMIC_RELAXED)
+
+struct metrics *metrics_open(const char *addr)
+{
+	struct metrics		*m;
+	struct sockaddr_un	sun;
+
+	m = calloc(1, sizeof(*m));
+	if (!m)
+		return NULL;
+
+	if (strncmp(addr, "unix:", 5)) {
+		m->fd = net_listen(addr);
+		if (m->fd < 0) {
+			free(m);
+			return NULL;
+		}
+		return m;
+	}
+
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_UNIX;
+	if (strlen(addr + 5) >= sizeof(sun.sun_path)) {
+		fprintf(stderr, "%s: path too long\n", addr);
+		free(m);
+		return NULL;
+	}
+	strcpy(sun.sun_path, addr + 5);
+
+	m->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m->fd < 0) {
+		free(m);
+		return NULL;
+	}
+
+	unlink(sun.sun_path);
+	if (bind(m->fd, (struct sockaddr *) &sun, sizeof(sun)) < 0 ||
+			listen(m->fd, 8) < 0) {
+		fprintf(stderr, "listen(%s) failed: %s\n", addr, strerror(errno));
+		close(m->fd);
+		free(m);
+		return NULL;
+	}
+	m->unix_path = strdup(sun.sun_path);
+	return m;
+}
+
+void metrics_close(struct metrics *m)
+{
+	if (!m)
+		return;
+
+	close(m->fd);
+	if (m->unix_path)
+		unlink(m->unix_path);
+	free(m->unix_path);
+	free(m);
+}
+
+/*
+ * Label values in the text format are quoted; backslash, double quote and
+ * newline have to be escaped. Returns a malloc'd copy.
+ */
+static char *label_escape(const char *s)
+{
+	char	*e, *p;
+
+	e = malloc(strlen(s) * 2 + 1);
+	if (!e)
+		return NULL;
+
+	for (p = e; *s; s++) {
+		if (*s == '\\' || *s == '"') {
+			*p++ = '\\';
+			*p++ = *s;
+		} else if (*s == '\n') {
+			*p++ = '\\';
+			*p++ = 'n';
+		} else {
+			*p++ = *s;
+		}
+	}
+	*p = '\0';
+	return e;
+}
+
+static void put_histogram(FILE *fp, const char *name, const char *path,
+		const char *op, struct lat_hist *h)
+{
+	unsigned long long	cum;
+	int			g, i;
+
+	/* one bucket per power of two keeps the series count sane */
+	cum = 0;
+	for (g = 0; g < LAT_HIST_GROUPS; g++) {
+		for (i = 0; i < LAT_HIST_SUB; i++)
+			cum += h->buckets[g * LAT_HIST_SUB + i];
+
+		fprintf(fp, "iob_latency_seconds_bucket{job=\"%s\",path=\"%s\","
+				"op=\"%s\",le=\"%.9f\"} %llu\n", name, path, op,
+				(lat_hist_bucket_upper(g * LAT_HIST_SUB +
+				LAT_HIST_SUB - 1) + 1) / (double) SEC_TO_NS,
+				cum);
+	}
+	fprintf(fp, "iob_latency_seconds_bucket{job=\"%s\",path=\"%s\","
+			"op=\"%s\",le=\"+Inf\"} %llu\n", name, path, op, cum);
+	fprintf(fp, "iob_latency_seconds_sum{job=\"%s\",path=\"%s\","
+			"op=\"%s\"} %.9f\n", name, path, op,
+			h->sum / (double) SEC_TO_NS);
+	fprintf(fp, "iob_latency_seconds_count{job=\"%s\",path=\"%s\","
+			"op=\"%s\"} %llu\n", name, path, op, cum);
+}
+
+/* snapshot of the counters of one worker */
+static void load_result(struct result_data *dst, struct result_data *src)
+{
+	int i;
+
+	dst->reads  = LOAD(src->reads);
+	dst->writes = LOAD(src->writes);
+
+	dst->read_hist.count  = LOAD(src->read_hist.count);
+	dst->read_hist.sum    = LOAD(src->read_hist.sum);
+	dst->write_hist.count = LOAD(src->write_hist.count);
+	dst->write_hist.sum   = LOAD(src->write_hist.sum);
+	for (i = 0; i < LAT_HIST_BUCKETS; i++) {
+		dst->read_hist.buckets[i]  = LOAD(src->read_hist.buckets[i]);
+		dst->write_hist.buckets[i] = LOAD(src->write_hist.buckets[i]);
+	}
+
+	for (i = 0; i < ENGINE_STATS; i++)
+		dst->engine.val[i] = LOAD(src->engine.val[i]);
+}
+
+static void put_metrics(FILE *fp, struct run *r)
+{
+	struct result_data	*rd;
+	struct result_data	*snap;
+	struct result_data	*jr;	/* per job totals */
+	struct ioengine		*ioengine;
+	struct job		*job;
+	char			**name, **path;	/* escaped label values */
+	int			i, j, k;
+
+	snap = malloc(sizeof(*snap));
+	jr   = calloc(r->no_jobs, sizeof(*jr));
+	name = calloc(r->no_jobs, sizeof(*name));
+	path = calloc(r->no_jobs, sizeof(*path));
+	if (!snap || !jr || !name || !path)
+		goto out;
+
+	for (j = 0; j < r->no_jobs; j++) {
+		name[j] = label_escape(r->jobs[j].name);
+		path[j] = label_escape(r->jobs[j].path);
+		if (!name[j] || !path[j])
+			goto out;
+	}
+
+	rd = r->results;
+	for (j = 0; j < r->no_jobs; j++) {
+		lat_hist_init(&jr[j].read_hist);
+		lat_hist_init(&jr[j].write_hist);
+		for (i = 0; i < r->jobs[j].procs; i++, rd++) {
+			memset(snap, 0, sizeof(*snap));
+			load_result(snap, rd);
+
+			jr[j].reads  += snap->reads;
+			jr[j].writes += snap->writes;
+			lat_hist_merge(&jr[j].read_hist, &snap->read_hist);
+			lat_hist_merge(&jr[j].write_hist, &snap->write_hist);
+			for (k = 0; k < ENGINE_STATS; k++)
+				jr[j].engine.val[k] += snap->engine.val[k];
+		}
+	}
+
+	fprintf(fp, "# HELP iob_ios_total Completed IOs.\n");
+	fprintf(fp, "# TYPE iob_ios_total counter\n");
+	for (j = 0; j < r->no_jobs; j++) {
+		fprintf(fp, "iob_ios_total{job=\"%s\",path=\"%s\",op=\"read\"} %lu\n",
+				name[j], path[j], jr[j].reads);
+		fprintf(fp, "iob_ios_total{job=\"%s\",path=\"%s\",op=\"write\"} %lu\n",
+				name[j], path[j], jr[j].writes);
+	}
+
+	fprintf(fp, "# HELP iob_bytes_total Bytes transferred.\n");
+	fprintf(fp, "# TYPE iob_bytes_total counter\n");
+	for (j = 0; j < r->no_jobs; j++) {
+		job = &r->jobs[j];
+		fprintf(fp, "iob_bytes_total{job=\"%s\",path=\"%s\",op=\"read\"} %llu\n",
+				name[j], path[j],
+				(unsigned long long) jr[j].reads * job->block_size);
+		fprintf(fp, "iob_bytes_total{job=\"%s\",path=\"%s\",op=\"write\"} %llu\n",
+				name[j], path[j],
+				(unsigned long long) jr[j].writes * job->block_size);
+	}
+
+	/* device totals over all jobs using the same path */
+	fprintf(fp, "# HELP iob_device_ios_total Completed IOs per path.\n");
+	fprintf(fp, "# TYPE iob_device_ios_total counter\n");
+	for (j = 0; j < r->no_jobs; j++) {
+		unsigned long reads = 0, writes = 0;
+
+		for (k = 0; k < j; k++)
+			if (!strcmp(r->jobs[k].path, r->jobs[j].path))
+				break;
+		if (k < j)
+			continue;
+
+		for (k = j; k < r->no_jobs; k++) {
+			if (strcmp(r->jobs[k].path, r->jobs[j].path))
+				continue;
+			reads  += jr[k].reads;
+			writes += jr[k].writes;
+		}
+		fprintf(fp, "iob_device_ios_total{path=\"%s\",op=\"read\"} %lu\n",
+				path[j], reads);
+		fprintf(fp, "iob_device_ios_total{path=\"%s\",op=\"write\"} %lu\n",
+				path[j], writes);
+	}
+
+	fprintf(fp, "# HELP iob_latency_seconds Per submission IO latency.\n");
+	fprintf(fp, "# TYPE iob_latency_seconds histogram\n");
+	for (j = 0; j < r->no_jobs; j++) {
+		put_histogram(fp, name[j], path[j], "read",
+				&jr[j].read_hist);
+		put_histogram(fp, name[j], path[j], "write",
+				&jr[j].write_hist);
+	}
+
+	fprintf(fp, "# HELP iob_engine_stat IO engine specific counters.\n");
+	fprintf(fp, "# TYPE iob_engine_stat counter\n");
+	for (j = 0; j < r->no_jobs; j++) {
+		job      = &r->jobs[j];
+		ioengine = get_ioengine(job->engine);
+		for (k = 0; ioengine && k < ENGINE_STATS; k++) {
+			if (!ioengine->stat_names[k])
+				continue;
+			fprintf(fp, "iob_engine_stat{job=\"%s\",engine=\"%s\","
+					"name=\"%s\"} %llu\n", name[j],
+					ioengine->name, ioengine->stat_names[k],
+					jr[j].engine.val[k]);
+		}
+	}
+
+out:
+	for (j = 0; j < r->no_jobs; j++) {
+		if (name)
+			free(name[j]);
+		if (path)
+			free(path[j]);
+	}
+	free(name);
+	free(path);
+	free(snap);
+	free(jr);
+}
+
+static void metrics_answer(int fd, struct run *r)
+{
+	struct timeval	tv = { .tv_sec = 0, .tv_usec = 100000 };
+	char		req[4096];
+	char		*body;
+	size_t		len;
+	FILE		*fp;
+	int		hdr;
+
+	/* the request itself does not matter, every path gets the metrics */
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	recv(fd, req, sizeof(req), 0);
+
+	body = NULL;
+	len  = 0;
+	fp   = open_memstream(&body, &len);
+	if (!fp)
+		return;
+	put_metrics(fp, r);
+	fclose(fp);
+
+	hdr = snprintf(req, sizeof(req), "HTTP/1.0 200 OK\r\n"
+			"Content-Type: text/plain; version=0.0.4\r\n"
+			"Content-Length: %zu\r\n\r\n", len);
+	if (send(fd, req, hdr, MSG_NOSIGNAL) == hdr)
+		send(fd, body, len, MSG_NOSIGNAL);
+	free(body);
+}
+
+void metrics_poll(struct metrics *m, struct run *r, int timeout_ms)
+{
+	struct pollfd	pfd = { .fd = m->fd, .events = POLLIN };
+	int		fd;
+
+	if (poll(&pfd, 1, timeout_ms) <= 0)
+		return;
+
+	fd = accept(m->fd, NULL, NULL);
+	if (fd < 0)
+		return;
+
+	metrics_answer(fd, r);
+	close(fd);
+}
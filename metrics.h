@@ -0,0 +1,42 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include "iob.h"
+
+/* Prometheus text exposition of the live results of a run */
+struct metrics {
+	int	fd;		/* listening socket */
+	char	*unix_path;	/* socket file, removed on close */
+};
+
+struct metrics *metrics_open(const char *addr);
+
+void metrics_close(struct metrics *m);
+
+/* waits up to timeout_ms for a scrape and answers it from r's results */
+void metrics_poll(struct metrics *m, struct run *r, int timeout_ms);
+
+#endif
@@ -0,0 +1,305 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#define _GNU_SOURCE
+#define _LARGEFILE64_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "ioengine.h"
+#include "iob.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define HUGE_PAGE_SIZE	(2UL * 1024 * 1024)
+
+enum {
+	MMAP_STAT_LOAD_NS,	/* loads from the mapping, incl. page faults */
+	MMAP_STAT_STORE_NS,	/* stores into the mapping */
+	MMAP_STAT_MSYNC_NS,	/* msync() writeback */
+	MMAP_STAT_MSYNCS,
+};
+
+static struct ioengine_options	opts;
+static struct engine_stats	*stats;
+static char			*map;		/* mapping of the worker's range */
+static unsigned long long	map_offset;	/* file offset of map[0] */
+static size_t			map_length;
+static char			*dirty_lo;	/* stored to, not synced yet */
+static char			*dirty_hi;
+static long			page_size;
+static int			clk_id = CLOCK_MONOTONIC;
+
+static int mmap_init(struct ioengine *e, struct ioengine_options *o)
+{
+	if (o->hipri || o->nowait || o->dsync) {
+		fprintf(stderr, "mmap does not support --hipri, --nowait or "
+				"--dsync.\n");
+		return -1;
+	}
+
+	opts = *o;
+	return 0;
+}
+
+/*
+ * Huge pages need the address, file offset and length all 2 MiB aligned;
+ * mmap() only guarantees the base page size for the address, so reserve
+ * one huge page more and map over the aligned part of the reservation.
+ */
+static char *map_huge(size_t length, int flags, int fd, off_t offset)
+{
+	char	*resv, *addr;
+	size_t	head;
+
+	resv = mmap(NULL, length + HUGE_PAGE_SIZE, PROT_NONE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (resv == MAP_FAILED)
+		return MAP_FAILED;
+
+	addr = (char *) (((uintptr_t) resv + HUGE_PAGE_SIZE - 1) &
+			~((uintptr_t) HUGE_PAGE_SIZE - 1));
+	head = addr - resv;
+	if (head)
+		munmap(resv, head);
+	munmap(addr + length, HUGE_PAGE_SIZE - head);
+
+	if (mmap(addr, length, PROT_READ | PROT_WRITE, flags | MAP_FIXED, fd,
+				offset) == MAP_FAILED) {
+		munmap(addr, length);
+		return MAP_FAILED;
+	}
+	return addr;
+}
+
+static int mmap_open(int fd, unsigned long long offset,
+		unsigned long long length, struct engine_stats *st)
+{
+	struct stat	buf;
+	unsigned long	align;
+	int		flags;
+
+	stats     = st;
+	page_size = sysconf(_SC_PAGESIZE);
+	align     = opts.hugepage ? HUGE_PAGE_SIZE : page_size;
+
+	map_offset = offset & ~((unsigned long long) align - 1);
+	map_length = length + (offset - map_offset);
+	if (opts.hugepage)
+		map_length = (map_length + align - 1) & ~(align - 1);
+
+	if (fstat(fd, &buf) < 0) {
+		fprintf(stderr, "fstat failed: %s\n", strerror(errno));
+		return -1;
+	}
+
+	/* stores past the end of a file raise SIGBUS, grow it first */
+	if (S_ISREG(buf.st_mode) && buf.st_size < offset + length &&
+			ftruncate(fd, offset + length) < 0) {
+		fprintf(stderr, "ftruncate failed: %s\n", strerror(errno));
+		return -1;
+	}
+
+	flags = MAP_SHARED;
+	if (opts.populate)
+		flags |= MAP_POPULATE;
+
+	if (opts.hugepage)
+		map = map_huge(map_length, flags, fd, map_offset);
+	else
+		map = mmap(NULL, map_length, PROT_READ | PROT_WRITE, flags, fd,
+				map_offset);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "mmap failed: %s\n", strerror(errno));
+		map = NULL;
+		return -1;
+	}
+
+	if (opts.hugepage && madvise(map, map_length, MADV_HUGEPAGE) < 0)
+		fprintf(stderr, "madvise(MADV_HUGEPAGE) failed: %s\n",
+				strerror(errno));
+
+	if (opts.advice >= 0 && madvise(map, map_length, opts.advice) < 0) {
+		fprintf(stderr, "madvise failed: %s\n", strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+static void mmap_close(int fd)
+{
+	if (!map)
+		return;
+
+	msync(map, map_length, MS_SYNC);
+	munmap(map, map_length);
+	map = NULL;
+	dirty_lo = dirty_hi = NULL;
+}
+
+/* --sync fsync:N and fdatasync:N, writes back what was stored since */
+static int mmap_sync(int fd, int data_only)
+{
+	unsigned long long	s;
+	char			*page;
+
+	if (!dirty_hi)
+		return 0;
+
+	s    = get_hrtime(clk_id);
+	page = (char *) ((uintptr_t) dirty_lo & ~((uintptr_t) page_size - 1));
+	if (msync(page, dirty_hi - page, MS_SYNC) < 0)
+		return -1;
+	stats->val[MMAP_STAT_MSYNC_NS] += get_hrtime(clk_id) - s;
+	stats->val[MMAP_STAT_MSYNCS]++;
+
+	dirty_lo = dirty_hi = NULL;
+	return 0;
+}
+
+static char *io_addr(unsigned long long offset, unsigned long length)
+{
+	if (offset < map_offset || offset + length > map_offset + map_length) {
+		fprintf(stderr, "offset %llu is outside of the mapping\n",
+				offset);
+		return NULL;
+	}
+	return map + (offset - map_offset);
+}
+
+/*
+ * Stores use non-temporal SSE2 stores when both sides are 16 byte aligned,
+ * so that the written pages do not evict the benchmark's own working set.
+ * Everything else goes through memcpy(), which is vectorized already.
+ */
+static void store(char *dst, const char *src, size_t n)
+{
+#if defined(__SSE2__)
+	if (!(((uintptr_t) dst | (uintptr_t) src | n) & 15)) {
+		__m128i		*d = (__m128i *) dst;
+		const __m128i	*s = (const __m128i *) src;
+		size_t		i;
+
+		for (i = 0; i < n / 16; i++)
+			_mm_stream_si128(d + i, _mm_load_si128(s + i));
+		_mm_sfence();
+		return;
+	}
+#endif
+	memcpy(dst, src, n);
+}
+
+static int read_at(int fd, void *buf, unsigned long long offset,
+		unsigned long length)
+{
+	char			*addr;
+	unsigned long long	s;
+
+	addr = io_addr(offset, length);
+	if (!addr)
+		return -1;
+
+	s = get_hrtime(clk_id);
+	memcpy(buf, addr, length);
+	stats->val[MMAP_STAT_LOAD_NS] += get_hrtime(clk_id) - s;
+	return 0;
+}
+
+static int write_at(int fd, void *buf, unsigned long long offset,
+		unsigned long length)
+{
+	char			*addr;
+	char			*page;
+	unsigned long long	s, e;
+
+	addr = io_addr(offset, length);
+	if (!addr)
+		return -1;
+
+	s = get_hrtime(clk_id);
+	store(addr, buf, length);
+	e = get_hrtime(clk_id);
+	stats->val[MMAP_STAT_STORE_NS] += e - s;
+
+	/* other policies leave the stores to the page cache or mmap_sync() */
+	if (opts.sync_policy != SYNC_DEFAULT &&
+			opts.sync_policy != SYNC_ALWAYS) {
+		if (!dirty_hi || addr < dirty_lo)
+			dirty_lo = addr;
+		if (addr + length > dirty_hi)
+			dirty_hi = addr + length;
+		return 0;
+	}
+
+	/* synchronous like O_SYNC for the other engines */
+	page = (char *) ((uintptr_t) addr & ~((uintptr_t) page_size - 1));
+	if (msync(page, addr + length - page, MS_SYNC) < 0) {
+		fprintf(stderr, "msync failed: %s\n", strerror(errno));
+		return -1;
+	}
+	stats->val[MMAP_STAT_MSYNC_NS] += get_hrtime(clk_id) - e;
+	stats->val[MMAP_STAT_MSYNCS]++;
+	return 0;
+}
+
+static int read_block(int fd, void *buf, unsigned long block,
+		unsigned long block_size)
+{
+	return read_at(fd, buf, (unsigned long long) block * block_size,
+			block_size);
+}
+
+static int write_block(int fd, void *buf, unsigned long block,
+		unsigned long block_size)
+{
+	return write_at(fd, buf, (unsigned long long) block * block_size,
+			block_size);
+}
+
+struct ioengine mmap_engine = {
+	.name		= "mmap",
+	.init		= mmap_init,
+	.open		= mmap_open,
+	.close		= mmap_close,
+	.read_block	= read_block,
+	.write_block	= write_block,
+	.read_at	= read_at,
+	.write_at	= write_at,
+	.sync		= mmap_sync,
+	.stat_names	= {
+		[MMAP_STAT_LOAD_NS]	= "load_ns",
+		[MMAP_STAT_STORE_NS]	= "store_ns",
+		[MMAP_STAT_MSYNC_NS]	= "msync_ns",
+		[MMAP_STAT_MSYNCS]	= "msyncs",
+	},
+};
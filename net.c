@@ -0,0 +1,644 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+
+#include "iob.h"
+#include "net.h"
+#include "target.h"
+#include "diskstats.h"
+
+static int net_write(int fd, const void *buf, size_t len)
+{
+	const char	*b = buf;
+	ssize_t		rc;
+
+	while (len > 0) {
+		rc = send(fd, b, len, MSG_NOSIGNAL);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		b   += rc;
+		len -= rc;
+	}
+	return 0;
+}
+
+static int net_read(int fd, void *buf, size_t len)
+{
+	char	*b = buf;
+	ssize_t	rc;
+
+	while (len > 0) {
+		rc = recv(fd, b, len, 0);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (rc == 0) {
+			errno = ECONNRESET;
+			return -1;
+		}
+		b   += rc;
+		len -= rc;
+	}
+	return 0;
+}
+
+static int net_send(int fd, uint32_t type, const void *buf, uint32_t len)
+{
+	struct net_hdr hdr = {
+		.magic	= NET_MAGIC,
+		.type	= type,
+		.length	= len,
+	};
+
+	if (net_write(fd, &hdr, sizeof(hdr)) < 0)
+		return -1;
+	return len ? net_write(fd, buf, len) : 0;
+}
+
+static int net_send_error(int fd, const char *msg)
+{
+	return net_send(fd, NET_ERROR, msg, strlen(msg) + 1);
+}
+
+/*
+ * Receives one message, the payload is malloc()ed and NUL terminated.
+ * Payloads longer than max, or than an error text, are refused before
+ * anything is allocated; the peer is not authenticated yet.
+ */
+static int net_recv(int fd, uint32_t *type, char **buf, uint32_t *len,
+		size_t max)
+{
+	struct net_hdr hdr;
+
+	*buf = NULL;
+	if (net_read(fd, &hdr, sizeof(hdr)) < 0)
+		return -1;
+
+	if (hdr.magic != NET_MAGIC || hdr.length > MAX(max, NET_ERROR_LENGTH)) {
+		errno = EPROTO;
+		return -1;
+	}
+
+	*buf = malloc(hdr.length + 1);
+	if (!*buf)
+		return -1;
+
+	if (net_read(fd, *buf, hdr.length) < 0) {
+		free(*buf);
+		*buf = NULL;
+		return -1;
+	}
+
+	(*buf)[hdr.length] = 0;
+	*type = hdr.type;
+	*len  = hdr.length;
+	return 0;
+}
+
+/* splits "host:port", "[v6addr]:port" or "port", no host is localhost */
+static int net_resolve(const char *addr, struct addrinfo **res)
+{
+	struct addrinfo	hints;
+	char		*host;
+	char		*port;
+	char		*p;
+	int		rc;
+
+	host = strdup(addr);
+	if (!host)
+		return -1;
+
+	p = strrchr(host, ':');
+	if (p) {
+		*p   = 0;
+		port = p + 1;
+		p    = host;
+	} else {
+		port = host;
+	}
+
+	if (!p || !*p) {
+		p = "localhost";
+	} else if (p && *p == '[') {
+		p++;
+		p[strlen(p) - 1] = 0;
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family   = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	rc = getaddrinfo(p, port, &hints, res);
+	if (rc) {
+		fprintf(stderr, "%s: %s\n", addr, gai_strerror(rc));
+		free(host);
+		return -1;
+	}
+	free(host);
+	return 0;
+}
+
+int net_listen(const char *addr)
+{
+	struct addrinfo	*res, *ai;
+	int		fd;
+	int		on = 1;
+
+	if (net_resolve(addr, &res) < 0)
+		return -1;
+
+	fd = -1;
+	for (ai = res; ai; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd < 0)
+			continue;
+
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+		if (!bind(fd, ai->ai_addr, ai->ai_addrlen) && !listen(fd, 8))
+			break;
+
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(res);
+
+	if (fd < 0)
+		fprintf(stderr, "listen(%s) failed: %s\n", addr, strerror(errno));
+	return fd;
+}
+
+static int net_connect(const char *addr)
+{
+	struct addrinfo	*res, *ai;
+	int		fd;
+	int		on = 1;
+
+	if (net_resolve(addr, &res) < 0)
+		return -1;
+
+	fd = -1;
+	for (ai = res; ai; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd < 0)
+			continue;
+
+		if (!connect(fd, ai->ai_addr, ai->ai_addrlen))
+			break;
+
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(res);
+
+	if (fd < 0) {
+		fprintf(stderr, "connect(%s) failed: %s\n", addr, strerror(errno));
+		return -1;
+	}
+
+	/* START has to leave right away for all agents to start together */
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+	return fd;
+}
+
+/* compares all of both tokens, so the time taken does not tell how much matched */
+static int token_equal(const char *a, const char *b)
+{
+	unsigned char	diff;
+	int		i;
+
+	diff = 0;
+	for (i = 0; i < NET_TOKEN_LENGTH; i++) {
+		diff |= a[i] ^ b[i];
+		if (!a[i] && !b[i])
+			break;
+	}
+	return !diff;
+}
+
+/* path is one of the allowed paths or below one, without .. components */
+static int path_allowed(const char *path, const struct agent_policy *policy)
+{
+	const char	*p;
+	size_t		len;
+	int		i;
+
+	for (p = path; (p = strstr(p, "..")); p += 2) {
+		if ((p == path || p[-1] == '/') && (!p[2] || p[2] == '/'))
+			return 0;
+	}
+
+	for (i = 0; i < policy->no_allow; i++) {
+		len = strlen(policy->allow[i]);
+		if (strncmp(path, policy->allow[i], len))
+			continue;
+		if (!path[len] || path[len] == '/' ||
+				(len && policy->allow[i][len - 1] == '/'))
+			return 1;
+	}
+	return 0;
+}
+
+/* jobs from the network must not load code or touch other paths */
+static const char *agent_check_jobs(struct job *jobs, int no_jobs,
+		const struct agent_policy *policy)
+{
+	char	path[PATH_MAX];
+	int	i, j;
+
+	for (j = 0; j < no_jobs; j++) {
+		jobs[j].name[sizeof(jobs[j].name) - 1]     = 0;
+		jobs[j].path[sizeof(jobs[j].path) - 1]     = 0;
+		jobs[j].engine[sizeof(jobs[j].engine) - 1] = 0;
+
+		if (strchr(jobs[j].engine, '/'))
+			return "plugin IO engines are not allowed on agents";
+
+		for (i = 0; i < job_stripe_width(&jobs[j]); i++) {
+			if (job_stripe_path(&jobs[j], i, path, sizeof(path)) < 0 ||
+					!path_allowed(path, policy))
+				return "path is not allowed on agent";
+		}
+	}
+	return NULL;
+}
+
+/* runs one workload for the controller connected on fd */
+static int agent_handle(int fd, const struct agent_policy *policy,
+		int clk_id, struct metrics *metrics)
+{
+	struct net_job	*nj;
+	struct run	run;
+	uint32_t	type;
+	uint32_t	len;
+	char		*buf;
+	const char	*msg;
+	int		rc;
+
+	/* every job has a worker at least */
+	if (net_recv(fd, &type, &buf, &len, sizeof(*nj) +
+				MAX_PROCESSES * sizeof(struct job)) < 0) {
+		fprintf(stderr, "receiving job failed: %s\n", strerror(errno));
+		return -1;
+	}
+
+	nj = (struct net_job *) buf;
+	if (type != NET_JOB || len < sizeof(*nj) ||
+			nj->version != NET_VERSION ||
+			nj->job_size != sizeof(struct job) ||
+			nj->result_size != sizeof(struct result_data) ||
+			len != sizeof(*nj) + nj->no_jobs * sizeof(struct job)) {
+		net_send_error(fd, "incompatible job, agents must run the "
+				"same iob build as the controller");
+		free(buf);
+		return -1;
+	}
+
+	nj->token[NET_TOKEN_LENGTH - 1] = 0;
+	if (!token_equal(nj->token, policy->token)) {
+		net_send_error(fd, "wrong token");
+		free(buf);
+		return -1;
+	}
+
+	memset(&run, 0, sizeof(run));
+	run.jobs    = (struct job *) (nj + 1);
+	run.no_jobs = nj->no_jobs;
+	run.seconds = nj->seconds;
+	run.clk_id  = clk_id;
+	run.metrics = metrics;
+	run.disk_interval  = nj->disk_interval;
+	run.slow_ring_size = nj->slow_ring_size;
+	run.journal = -1;
+
+	msg = agent_check_jobs(run.jobs, run.no_jobs, policy);
+	rc  = -1;
+	if (msg) {
+		net_send_error(fd, msg);
+		free(buf);
+		return -1;
+	}
+
+	if (run_prepare(&run) < 0) {
+		msg = "job validation failed on agent";
+		goto out;
+	}
+
+	if (run_start(&run) < 0) {
+		msg = "starting workers failed on agent";
+		run_abort(&run);
+		goto out;
+	}
+
+	if (net_send(fd, NET_READY, NULL, 0) < 0) {
+		run_abort(&run);
+		goto out;
+	}
+
+	free(buf);
+	if (net_recv(fd, &type, &buf, &len, 0) < 0 || type != NET_START) {
+		fprintf(stderr, "controller did not start the run.\n");
+		run_abort(&run);
+		goto out;
+	}
+	nj = NULL;
+
+	run_go(&run);
+	run_wait(&run);
+
+	/* the devices are local, so is their report */
+	if (run.disks)
+		diskstats_report(run.disks, &run, stdout);
+
+	if (net_send(fd, NET_RESULT, run.results,
+			sizeof(*run.results) * run.no_results) < 0) {
+		fprintf(stderr, "sending results failed: %s\n", strerror(errno));
+		goto out;
+	}
+	rc = 0;
+
+out:
+	if (msg)
+		net_send_error(fd, msg);
+	run_free(&run);
+	free(buf);
+	return rc;
+}
+
+int agent_serve(const char *addr, const struct agent_policy *policy,
+		int clk_id, struct metrics *metrics)
+{
+	int	lfd;
+	int	fd;
+
+	if (!policy->token || !*policy->token || !policy->no_allow) {
+		fprintf(stderr, "An agent needs --token and --allow.\n");
+		return 1;
+	}
+
+	if (strlen(policy->token) >= NET_TOKEN_LENGTH) {
+		fprintf(stderr, "Token must be shorter than %d characters.\n",
+				NET_TOKEN_LENGTH);
+		return 1;
+	}
+
+	lfd = net_listen(addr);
+	if (lfd < 0)
+		return 1;
+
+	printf("Agent listening on %s\n", addr);
+	fflush(stdout);
+
+	while (1) {
+		fd = accept(lfd, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "accept failed: %s\n", strerror(errno));
+			break;
+		}
+
+		printf(agent_handle(fd, policy, clk_id, metrics) < 0 ?
+				"Workload failed\n" : "Workload finished\n");
+		fflush(stdout);
+		close(fd);
+	}
+
+	close(lfd);
+	return 1;
+}
+
+/* expects a message of type want from every agent */
+static int controller_gather(int *fds, char **agents, int no_agents,
+		uint32_t want, char **bufs, uint32_t size)
+{
+	uint32_t	type;
+	uint32_t	len;
+	char		*buf;
+	int		failed;
+	int		a;
+
+	failed = 0;
+	for (a = 0; a < no_agents; a++) {
+		if (net_recv(fds[a], &type, &buf, &len, size) < 0) {
+			fprintf(stderr, "%s: %s\n", agents[a], strerror(errno));
+			failed = 1;
+			continue;
+		}
+
+		if (type == NET_ERROR) {
+			fprintf(stderr, "%s: %s\n", agents[a], buf);
+			failed = 1;
+		} else if (type != want || len != size) {
+			fprintf(stderr, "%s: unexpected message %u\n",
+					agents[a], type);
+			failed = 1;
+		}
+
+		if (bufs && !failed)
+			bufs[a] = buf;
+		else
+			free(buf);
+	}
+	return failed ? -1 : 0;
+}
+
+/*
+ * Prints the per agent totals and one report over all agents, in which
+ * each job has the workers of every agent.
+ */
+static void controller_report(char **agents, int no_agents,
+		struct job *jobs, int no_jobs, char **bufs)
+{
+	struct result_data	*results;
+	struct result_data	*rd, *src;
+	struct job		*cjobs;
+	struct lat_hist		h;
+	int			no_results;
+	int			a, i, j, off;
+
+	no_results = 0;
+	for (j = 0; j < no_jobs; j++)
+		no_results += jobs[j].procs;
+
+	for (a = 0; a < no_agents; a++) {
+		src = (struct result_data *) bufs[a];
+		lat_hist_init(&h);
+		for (i = 0; i < no_results; i++)
+			lat_hist_merge(&h, &src[i].write_hist);
+
+		printf("\nAgent = %s\n", agents[a]);
+		printf("writes = %llu\n", h.count);
+		lat_hist_print("write", &h);
+	}
+
+	cjobs   = calloc(no_jobs, sizeof(*cjobs));
+	results = calloc(no_results * no_agents, sizeof(*results));
+	if (!cjobs || !results) {
+		fprintf(stderr, "Memory Allocation Failed.\n");
+		free(cjobs);
+		free(results);
+		return;
+	}
+
+	/* group the workers of each job from all agents together */
+	rd  = results;
+	off = 0;
+	for (j = 0; j < no_jobs; j++) {
+		cjobs[j]        = jobs[j];
+		cjobs[j].procs *= no_agents;
+
+		for (a = 0; a < no_agents; a++) {
+			src = (struct result_data *) bufs[a] + off;
+			for (i = 0; i < jobs[j].procs; i++) {
+				*rd = src[i];
+				rd->job_index = j;
+				rd++;
+			}
+		}
+		off += jobs[j].procs;
+	}
+
+	printf("\n\nCluster wide stats (%d agents):", no_agents);
+	run_report(cjobs, no_jobs, results);
+
+	free(cjobs);
+	free(results);
+}
+
+int controller_run(char **agents, int no_agents, struct run *r,
+		const char *token)
+{
+	struct job	*jobs = r->jobs;
+	int		no_jobs = r->no_jobs;
+	struct net_job	*nj;
+	char		**bufs;
+	int		*fds;
+	size_t		len;
+	size_t		results_size;
+	int		rc;
+	int		a, j;
+
+	/* agents run their own journal and cgroups, if any */
+	if (r->journal_path || r->cgroup_root) {
+		fprintf(stderr, "--durability and --cgroup-root can not be "
+				"used with --client.\n");
+		return 1;
+	}
+
+	if (!token || strlen(token) >= NET_TOKEN_LENGTH) {
+		fprintf(stderr, "--client needs a --token shorter than %d "
+				"characters.\n", NET_TOKEN_LENGTH);
+		return 1;
+	}
+
+	fds  = calloc(no_agents, sizeof(*fds));
+	bufs = calloc(no_agents, sizeof(*bufs));
+	len  = sizeof(*nj) + no_jobs * sizeof(*jobs);
+	nj   = malloc(len);
+	if (!fds || !bufs || !nj) {
+		fprintf(stderr, "Memory Allocation Failed.\n");
+		return 1;
+	}
+
+	memset(nj, 0, sizeof(*nj));
+	nj->version     = NET_VERSION;
+	nj->job_size    = sizeof(struct job);
+	nj->result_size = sizeof(struct result_data);
+	nj->no_jobs     = no_jobs;
+	nj->seconds     = r->seconds;
+	nj->disk_interval  = r->disk_interval;
+	nj->slow_ring_size = r->slow_ring_size;
+	strcpy(nj->token, token);
+	memcpy(nj + 1, jobs, no_jobs * sizeof(*jobs));
+
+	results_size = 0;
+	for (j = 0; j < no_jobs; j++)
+		results_size += jobs[j].procs * sizeof(struct result_data);
+
+	rc = 1;
+	for (a = 0; a < no_agents; a++)
+		fds[a] = -1;
+
+	for (a = 0; a < no_agents; a++) {
+		fds[a] = net_connect(agents[a]);
+		if (fds[a] < 0)
+			goto out;
+
+		if (net_send(fds[a], NET_JOB, nj, len) < 0) {
+			fprintf(stderr, "%s: %s\n", agents[a], strerror(errno));
+			goto out;
+		}
+	}
+
+	if (controller_gather(fds, agents, no_agents, NET_READY, NULL, 0) < 0)
+		goto out;
+
+	/* all agents have their workers forked, release them together */
+	for (a = 0; a < no_agents; a++) {
+		if (net_send(fds[a], NET_START, NULL, 0) < 0) {
+			fprintf(stderr, "%s: %s\n", agents[a], strerror(errno));
+			goto out;
+		}
+	}
+	printf("Started %d agents\n", no_agents);
+	fflush(stdout);
+
+	if (controller_gather(fds, agents, no_agents, NET_RESULT, bufs,
+				results_size) < 0)
+		goto out;
+
+	printf("Finished\n");
+	controller_report(agents, no_agents, jobs, no_jobs, bufs);
+	rc = 0;
+
+out:
+	/* agents waiting for START abort their workers on close */
+	for (a = 0; a < no_agents; a++) {
+		if (fds[a] >= 0)
+			close(fds[a]);
+		free(bufs[a]);
+	}
+	free(bufs);
+	free(fds);
+	free(nj);
+	return rc;
+}
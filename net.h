@@ -0,0 +1,85 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __NET_H__
+#define __NET_H__
+
+#include <stdint.h>
+
+#include "iob.h"
+
+/*
+ * Controller/agent protocol. Jobs and results are exchanged as raw
+ * structures, so every host has to run the same build of iob; the sizes
+ * in struct net_job catch most mismatches.
+ */
+#define NET_MAGIC	0x494f4231	/* "IOB1" */
+#define NET_VERSION	2
+#define NET_TOKEN_LENGTH	64
+#define NET_ERROR_LENGTH	4096	/* longest NET_ERROR text */
+
+enum net_msg {
+	NET_JOB = 1,	/* controller -> agent: struct net_job + jobs */
+	NET_READY,	/* agent -> controller: workers forked */
+	NET_START,	/* controller -> agent: start IO */
+	NET_RESULT,	/* agent -> controller: struct result_data array */
+	NET_ERROR,	/* either way: text message */
+};
+
+struct net_hdr {
+	uint32_t	magic;
+	uint32_t	type;
+	uint32_t	length;		/* payload bytes following the header */
+};
+
+struct net_job {
+	uint32_t	version;
+	uint32_t	job_size;	/* sizeof(struct job) */
+	uint32_t	result_size;	/* sizeof(struct result_data) */
+	uint32_t	no_jobs;
+	uint64_t	seconds;
+	char		token[NET_TOKEN_LENGTH];	/* must match the agent's */
+
+	/* run wide settings, see struct run */
+	uint64_t	disk_interval;
+	uint32_t	slow_ring_size;
+	uint32_t	pad;
+};
+
+/* what an agent accepts from controllers */
+struct agent_policy {
+	const char	*token;		/* shared secret, required */
+	char		**allow;	/* paths jobs may use, and below them */
+	int		no_allow;
+};
+
+/* listens on "[host:]port", on localhost unless host is given */
+int net_listen(const char *addr);
+
+int agent_serve(const char *addr, const struct agent_policy *policy,
+		int clk_id, struct metrics *metrics);
+
+int controller_run(char **agents, int no_agents, struct run *r,
+		const char *token);
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <stdio.h>
+#include "ioengine.h"
+
+/*
+ * Completes every IO instantly without touching the device. Useful to find
+ * the IOPS ceiling of the harness itself.
+ */
+static int read_block(int fd, void *buf, unsigned long block,
+		unsigned long block_size)
+{
+	return 0;
+}
+
+static int write_block(int fd, void *buf, unsigned long block,
+		unsigned long block_size)
+{
+	return 0;
+}
+
+static int rw_at(int fd, void *buf, unsigned long long offset,
+		unsigned long length)
+{
+	return 0;
+}
+
+static int write_blocks(int fd, void *buf, unsigned long *blocks, int nr,
+		unsigned long block_size)
+{
+	return 0;
+}
+
+struct ioengine null_engine = {
+	.name		= "null",
+	.read_block	= read_block,
+	.write_block	= write_block,
+	.write_blocks	= write_blocks,
+	.read_at	= rw_at,
+	.write_at	= rw_at,
+};
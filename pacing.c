@@ -0,0 +1,147 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <time.h>
+#include <errno.h>
+
+#include "iob.h"
+#include "pacing.h"
+
+/* shorter gaps are busy polled, timer slack would make them much longer */
+#define PACE_SPIN_NS	(50ULL * SEC_TO_NS / SEC_TO_MICRO)
+
+static inline void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+void sleep_until(unsigned long long ns)
+{
+	struct timespec		ts;
+	unsigned long long	now;
+
+	now = get_hrtime(CLOCK_MONOTONIC);
+	if (ns <= now)
+		return;
+
+	if (ns - now > PACE_SPIN_NS) {
+		ts.tv_sec  = (ns - PACE_SPIN_NS) / SEC_TO_NS;
+		ts.tv_nsec = (ns - PACE_SPIN_NS) % SEC_TO_NS;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts,
+					NULL) == EINTR)
+			;
+	}
+
+	while (get_hrtime(CLOCK_MONOTONIC) < ns)
+		cpu_relax();
+}
+
+void pacer_init(struct pacer *p, unsigned long long rate_interval,
+		unsigned long long thinktime, unsigned long long burst,
+		unsigned long long burst_interval, unsigned long long duty_on,
+		unsigned long long duty_off)
+{
+	p->rate_interval  = rate_interval;
+	p->thinktime      = thinktime;
+	p->burst          = burst;
+	p->burst_interval = burst_interval;
+	p->duty_on        = duty_on;
+	p->duty_off       = duty_off;
+
+	p->active = rate_interval || thinktime || burst || duty_on;
+
+	p->next_rate    = 0;
+	p->last_done    = 0;
+	p->period_start = get_hrtime(CLOCK_MONOTONIC);
+	p->issued       = 0;
+}
+
+static unsigned long long pacer_period(struct pacer *p)
+{
+	return p->burst ? p->burst_interval : p->duty_on + p->duty_off;
+}
+
+/*
+ * Sleeps until the next IO may be issued and tells whether it belongs to
+ * a burst. A burst is either the first burst IOs of every burst_interval or
+ * the first duty_on of every duty cycle. Between bursts IOs are issued
+ * thinktime apart, or not at all without a thinktime.
+ */
+static enum pace_phase pacer_schedule(struct pacer *p)
+{
+	unsigned long long	period;
+	unsigned long long	now;
+	unsigned long long	end;
+
+	period = pacer_period(p);
+	if (!period) {
+		if (p->thinktime && p->last_done)
+			sleep_until(p->last_done + p->thinktime);
+		return PACE_NONE;
+	}
+
+	while (1) {
+		now = get_hrtime(CLOCK_MONOTONIC);
+		if (now >= p->period_start + period) {
+			p->period_start += (now - p->period_start) / period * period;
+			p->issued = 0;
+		}
+		end = p->period_start + period;
+
+		if (p->burst ? p->issued < p->burst :
+				now - p->period_start < p->duty_on) {
+			p->issued++;
+			return PACE_BURST;
+		}
+
+		if (p->thinktime && p->last_done + p->thinktime < end) {
+			sleep_until(p->last_done + p->thinktime);
+			p->issued++;
+			return PACE_QUIET;
+		}
+
+		sleep_until(end);
+	}
+}
+
+enum pace_phase pacer_wait(struct pacer *p)
+{
+	enum pace_phase phase;
+
+	phase = pacer_schedule(p);
+
+	if (p->rate_interval) {
+		if (!p->next_rate)
+			p->next_rate = get_hrtime(CLOCK_MONOTONIC);
+		sleep_until(p->next_rate);
+	}
+	return phase;
+}
+
+void pacer_done(struct pacer *p, int nr)
+{
+	p->last_done  = get_hrtime(CLOCK_MONOTONIC);
+	p->next_rate += p->rate_interval * nr;
+}
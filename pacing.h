@@ -0,0 +1,61 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __PACING_H__
+#define __PACING_H__
+
+enum pace_phase {
+	PACE_NONE,	/* no burst schedule */
+	PACE_BURST,	/* IO issued back to back within a burst */
+	PACE_QUIET,	/* IO issued between bursts */
+};
+
+/* all times in ns, CLOCK_MONOTONIC */
+struct pacer {
+	int			active;
+
+	unsigned long long	rate_interval;	/* min gap, from the rate limit */
+	unsigned long long	thinktime;	/* gap after a quiet IO */
+	unsigned long long	burst;		/* IOs per burst */
+	unsigned long long	burst_interval;	/* burst start to burst start */
+	unsigned long long	duty_on;	/* burst length */
+	unsigned long long	duty_off;	/* quiet length */
+
+	unsigned long long	next_rate;
+	unsigned long long	last_done;
+	unsigned long long	period_start;
+	unsigned long long	issued;		/* IOs issued in this period */
+};
+
+void pacer_init(struct pacer *p, unsigned long long rate_interval,
+		unsigned long long thinktime, unsigned long long burst,
+		unsigned long long burst_interval, unsigned long long duty_on,
+		unsigned long long duty_off);
+
+enum pace_phase pacer_wait(struct pacer *p);
+
+void pacer_done(struct pacer *p, int nr);
+
+void sleep_until(unsigned long long ns);
+
+#endif
@@ -0,0 +1,325 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Wraps engines loaded from shared objects, see iob_plugin.h, into a
+ * struct ioengine. Per worker state is kept in globals like the built in
+ * engines do, each worker being a process of its own.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <dlfcn.h>
+
+#include "iob.h"
+#include "ioengine.h"
+
+#define MAX_PLUGINS		8
+#define MAX_PLUGIN_OPTIONS	32
+
+struct plugin {
+	struct ioengine		engine;		/* first, engine is the plugin */
+	char			path[IOENGINE_PATH_LENGTH];
+	void			*handle;
+	const struct iob_plugin	*p;
+};
+
+static struct plugin	*plugins[MAX_PLUGINS];
+static int		no_plugins;
+
+/* state of the worker process */
+static struct plugin	*cur;
+static void		*data;
+static int		initialized;
+static struct iob_option opts[MAX_PLUGIN_OPTIONS];
+static int		no_opts;
+static char		opts_buf[IOENGINE_OPTS_LENGTH];
+static const char	*path;
+static unsigned long	block_size;
+static unsigned int	depth;
+static int		direct;
+static int		clock_id;
+
+/* splits "key=value,key=value" into opts */
+static int plugin_options(const char *str)
+{
+	char	*s, *save, *val;
+
+	snprintf(opts_buf, sizeof(opts_buf), "%s", str);
+	no_opts = 0;
+	for (s = strtok_r(opts_buf, ",", &save); s;
+			s = strtok_r(NULL, ",", &save)) {
+		if (no_opts == MAX_PLUGIN_OPTIONS)
+			return -1;
+
+		val = strchr(s, '=');
+		if (val)
+			*val++ = 0;
+		opts[no_opts].key   = s;
+		opts[no_opts].value = val ? val : "";
+		no_opts++;
+	}
+	return 0;
+}
+
+static int pl_init(struct ioengine *e, struct ioengine_options *o)
+{
+	struct plugin	*pl = (struct plugin *) e;
+	int		rc;
+
+	if (o->hipri || o->nowait || o->dsync || o->populate ||
+			o->hugepage || o->advice >= 0) {
+		fprintf(stderr, "%s: use -O for plugin options.\n", e->name);
+		return -1;
+	}
+
+	if (o->depth > pl->engine.max_depth) {
+		fprintf(stderr, "%s supports a queue depth of %u.\n", e->name,
+				pl->engine.max_depth);
+		return -1;
+	}
+
+	if (plugin_options(o->opts) < 0) {
+		fprintf(stderr, "%s: too many options.\n", e->name);
+		return -1;
+	}
+
+	if (initialized && cur->p->teardown)
+		cur->p->teardown();
+	initialized = 0;
+
+	cur        = pl;
+	path       = o->path;
+	block_size = o->block_size;
+	direct     = o->direct;
+	clock_id   = o->clk_id;
+	depth      = o->depth ? o->depth : 1;
+	if (cur->p->init) {
+		rc = cur->p->init(opts, no_opts);
+		if (rc < 0) {
+			fprintf(stderr, "%s init failed: %s\n", e->name,
+					strerror(-rc));
+			return -1;
+		}
+	}
+	initialized = 1;
+	return 0;
+}
+
+static int pl_open(int fd, unsigned long long offset,
+		unsigned long long length, struct engine_stats *es)
+{
+	struct iob_target	t;
+	int			rc;
+
+	memset(&t, 0, sizeof(t));
+	t.path       = path;
+	t.fd         = fd;
+	t.offset     = offset;
+	t.length     = length;
+	t.block_size = block_size;
+	t.depth      = depth;
+	t.direct     = direct;
+	t.stats      = es->val;
+	t.clock_id   = clock_id;
+
+	rc = cur->p->open(&data, &t);
+	if (rc < 0) {
+		fprintf(stderr, "%s open failed: %s\n", cur->engine.name,
+				strerror(-rc));
+		return -1;
+	}
+	return 0;
+}
+
+static void pl_close(int fd)
+{
+	cur->p->close(data);
+	data = NULL;
+
+	if (cur->p->teardown)
+		cur->p->teardown();
+	initialized = 0;
+}
+
+static int pl_register_buffers(int fd, void **bufs, unsigned int nr,
+		unsigned long size)
+{
+	int rc;
+
+	if (!cur->p->register_buffers)
+		return 0;
+
+	rc = cur->p->register_buffers(data, bufs, nr, size);
+	if (rc < 0) {
+		fprintf(stderr, "%s buffer registration failed: %s\n",
+				cur->engine.name, strerror(-rc));
+		return -1;
+	}
+	return 0;
+}
+
+static int pl_submit(int fd, struct iob_io **ios, unsigned int nr)
+{
+	return cur->p->submit(data, ios, nr);
+}
+
+static int pl_reap(int fd, struct iob_io **ios, unsigned int min,
+		unsigned int max)
+{
+	return cur->p->reap(data, ios, min, max);
+}
+
+/* one IO at a time for the synchronous paths of do_io() */
+static int pl_rw(int fd, void *buf, unsigned long long offset,
+		unsigned long length, int write)
+{
+	struct iob_io	io, *iop;
+	int		rc;
+
+	memset(&io, 0, sizeof(io));
+	io.buf    = buf;
+	io.offset = offset;
+	io.length = length;
+	io.write  = write;
+
+	iop = &io;
+	rc  = cur->p->submit(data, &iop, 1);
+	if (rc == 1)
+		rc = cur->p->reap(data, &iop, 1, 1);
+	if (rc != 1 || io.result != length) {
+		fprintf(stderr, "%s %s at offset %llu failed: %s\n",
+				cur->engine.name, write ? "write" : "read", offset,
+				rc < 0 ? strerror(-rc) : io.result < 0 ?
+				strerror(-io.result) : "short IO");
+		return -1;
+	}
+	return 0;
+}
+
+static int pl_read_block(int fd, void *buf, unsigned long block,
+		unsigned long block_size)
+{
+	return pl_rw(fd, buf, (unsigned long long) block * block_size,
+			block_size, 0);
+}
+
+static int pl_write_block(int fd, void *buf, unsigned long block,
+		unsigned long block_size)
+{
+	return pl_rw(fd, buf, (unsigned long long) block * block_size,
+			block_size, 1);
+}
+
+static int pl_read_at(int fd, void *buf, unsigned long long offset,
+		unsigned long length)
+{
+	return pl_rw(fd, buf, offset, length, 0);
+}
+
+static int pl_write_at(int fd, void *buf, unsigned long long offset,
+		unsigned long length)
+{
+	return pl_rw(fd, buf, offset, length, 1);
+}
+
+struct ioengine *plugin_load(const char *path)
+{
+	const struct iob_plugin	*(*reg)(void);
+	const struct iob_plugin	*p;
+	struct plugin		*pl;
+	void			*handle;
+	int			i;
+
+	for (i = 0; i < no_plugins; i++)
+		if (!strcmp(plugins[i]->path, path))
+			return &plugins[i]->engine;
+
+	if (no_plugins == MAX_PLUGINS || strlen(path) >= sizeof(pl->path)) {
+		fprintf(stderr, "%s: too many plugins.\n", path);
+		return NULL;
+	}
+
+	handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	if (!handle) {
+		fprintf(stderr, "dlopen failed: %s\n", dlerror());
+		return NULL;
+	}
+
+	reg = (const struct iob_plugin *(*)(void)) dlsym(handle,
+			IOB_PLUGIN_SYMBOL);
+	p   = reg ? reg() : NULL;
+	if (!p) {
+		fprintf(stderr, "%s: no %s().\n", path, IOB_PLUGIN_SYMBOL);
+		goto error;
+	}
+
+	if ((p->abi >> 16) != IOB_PLUGIN_ABI_MAJOR ||
+			p->size < offsetof(struct iob_plugin, reap) +
+				sizeof(p->reap)) {
+		fprintf(stderr, "%s: plugin ABI %u.%u, iob supports %u.x\n",
+				path, p->abi >> 16, p->abi & 0xffff,
+				IOB_PLUGIN_ABI_MAJOR);
+		goto error;
+	}
+
+	if (!p->name || !p->open || !p->close || !p->submit || !p->reap) {
+		fprintf(stderr, "%s: incomplete plugin.\n", path);
+		goto error;
+	}
+
+	pl = calloc(1, sizeof(*pl));
+	if (!pl) {
+		fprintf(stderr, "Memory Allocation Failed.\n");
+		goto error;
+	}
+
+	strcpy(pl->path, path);
+	pl->handle = handle;
+	pl->p      = p;
+	snprintf(pl->engine.name, sizeof(pl->engine.name), "%s", p->name);
+	pl->engine.init             = pl_init;
+	pl->engine.open             = pl_open;
+	pl->engine.close            = pl_close;
+	pl->engine.read_block       = pl_read_block;
+	pl->engine.write_block      = pl_write_block;
+	pl->engine.read_at          = pl_read_at;
+	pl->engine.write_at         = pl_write_at;
+	pl->engine.max_depth        = p->max_depth ? p->max_depth : 1;
+	pl->engine.register_buffers = pl_register_buffers;
+	pl->engine.submit           = pl_submit;
+	pl->engine.reap             = pl_reap;
+	for (i = 0; i < ENGINE_STATS; i++)
+		pl->engine.stat_names[i] = p->stat_names[i];
+
+	plugins[no_plugins++] = pl;
+	return &pl->engine;
+
+error:
+	dlclose(handle);
+	return NULL;
+}
@@ -0,0 +1,208 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Example engine plugin on POSIX AIO:
+ *
+ *	make posixaio.so
+ *	iob -E ./posixaio.so --iodepth 16 -O reqprio=0 /dev/sdb
+ */
+
+#define _GNU_SOURCE
+
+#include <aio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "iob_plugin.h"
+
+enum {
+	AIO_STAT_SUBMITS,	/* aio_read/aio_write calls */
+	AIO_STAT_SUSPENDS,	/* aio_suspend calls */
+};
+
+struct aio_data {
+	int			fd;
+	int			clock_id;
+	unsigned long long	*stats;
+	unsigned int		depth;
+	struct aiocb		*cbs;		/* one per IO in flight */
+	struct aiocb		**free_cbs;	/* must not move while in use */
+	unsigned int		no_free;
+	struct iob_io		**pending;
+	const struct aiocb	**list;		/* for aio_suspend */
+	unsigned int		no_pending;
+};
+
+static int reqprio;
+
+static int aio_plugin_init(const struct iob_option *opts, int nr)
+{
+	int i;
+
+	reqprio = 0;
+	for (i = 0; i < nr; i++) {
+		if (strcmp(opts[i].key, "reqprio"))
+			return -EINVAL;
+		reqprio = atoi(opts[i].value);
+	}
+	return 0;
+}
+
+static int aio_plugin_open(void **data, const struct iob_target *t)
+{
+	struct aio_data *ad;
+
+	ad = calloc(1, sizeof(*ad));
+	if (!ad)
+		return -ENOMEM;
+
+	ad->fd      = t->fd;
+	ad->clock_id = t->clock_id;
+	ad->stats   = t->stats;
+	ad->depth   = t->depth;
+	ad->cbs      = calloc(t->depth, sizeof(*ad->cbs));
+	ad->free_cbs = calloc(t->depth, sizeof(*ad->free_cbs));
+	ad->pending  = calloc(t->depth, sizeof(*ad->pending));
+	ad->list     = calloc(t->depth, sizeof(*ad->list));
+	if (!ad->cbs || !ad->free_cbs || !ad->pending || !ad->list) {
+		free(ad->cbs);
+		free(ad->free_cbs);
+		free(ad->pending);
+		free(ad->list);
+		free(ad);
+		return -ENOMEM;
+	}
+
+	for (ad->no_free = 0; ad->no_free < ad->depth; ad->no_free++)
+		ad->free_cbs[ad->no_free] = &ad->cbs[ad->no_free];
+
+	*data = ad;
+	return 0;
+}
+
+static void aio_plugin_close(void *data)
+{
+	struct aio_data *ad = data;
+
+	free(ad->cbs);
+	free(ad->free_cbs);
+	free(ad->pending);
+	free(ad->list);
+	free(ad);
+}
+
+static int aio_plugin_submit(void *data, struct iob_io **ios, unsigned int nr)
+{
+	struct aio_data	*ad = data;
+	struct aiocb	*cb;
+	unsigned int	i;
+	int		rc;
+
+	for (i = 0; i < nr && ad->no_free; i++) {
+		cb = ad->free_cbs[ad->no_free - 1];
+		memset(cb, 0, sizeof(*cb));
+		cb->aio_fildes  = ad->fd;
+		cb->aio_buf     = ios[i]->buf;
+		cb->aio_nbytes  = ios[i]->length;
+		cb->aio_offset  = ios[i]->offset;
+		cb->aio_reqprio = reqprio;
+
+		rc = ios[i]->write ? aio_write(cb) : aio_read(cb);
+		if (rc < 0) {
+			if (errno == EAGAIN)
+				break;
+			return i ? i : -errno;
+		}
+
+		ios[i]->engine_data = cb;
+		ad->no_free--;
+		ad->pending[ad->no_pending++] = ios[i];
+		ad->stats[AIO_STAT_SUBMITS]++;
+	}
+	return i;
+}
+
+static int aio_plugin_reap(void *data, struct iob_io **ios, unsigned int min,
+		unsigned int max)
+{
+	struct aio_data	*ad = data;
+	struct aiocb	*cb;
+	struct iob_io	*io;
+	struct timespec	ts;
+	unsigned int	i, n;
+	ssize_t		rc;
+	int		err;
+
+	n = 0;
+	for (;;) {
+		for (i = 0; i < ad->no_pending && n < max; ) {
+			io  = ad->pending[i];
+			cb  = io->engine_data;
+			err = aio_error(cb);
+			if (err == EINPROGRESS) {
+				i++;
+				continue;
+			}
+
+			clock_gettime(ad->clock_id, &ts);
+			io->complete_ns = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+
+			rc         = aio_return(cb);
+			io->result = err ? -err : rc;
+			ios[n++]   = io;
+			ad->free_cbs[ad->no_free++] = cb;
+			ad->pending[i] = ad->pending[--ad->no_pending];
+		}
+
+		if (n >= min || !ad->no_pending)
+			return n;
+
+		for (i = 0; i < ad->no_pending; i++)
+			ad->list[i] = ad->pending[i]->engine_data;
+		ad->stats[AIO_STAT_SUSPENDS]++;
+		if (aio_suspend(ad->list, ad->no_pending, NULL) < 0 &&
+				errno != EINTR && errno != EAGAIN)
+			return -errno;
+	}
+}
+
+static const struct iob_plugin aio_plugin = {
+	.abi		= IOB_PLUGIN_ABI,
+	.size		= sizeof(struct iob_plugin),
+	.name		= "posixaio",
+	.max_depth	= 256,
+	.stat_names	= { "submits", "suspends" },
+	.init		= aio_plugin_init,
+	.open		= aio_plugin_open,
+	.close		= aio_plugin_close,
+	.submit		= aio_plugin_submit,
+	.reap		= aio_plugin_reap,
+};
+
+const struct iob_plugin *iob_plugin_register(void)
+{
+	return &aio_plugin;
+}
@@ -34,17 +34,15 @@
 #include <unistd.h>
 #include "ioengine.h"
 
-static int read_block(int fd, void *buf, unsigned long block,
-		unsigned long block_size)
+static int read_at(int fd, void *buf, unsigned long long offset,
+		unsigned long length)
 {
 	char		*b;
-	off64_t		offset;
 	unsigned long	remaining;
 	ssize_t		rc;
 
 	b		= buf;
-	offset		= block * block_size;
-	remaining	= block_size;
+	remaining	= length;
 
 	while (remaining > 0) {
 		rc = pread64(fd, b, remaining, offset);
@@ -63,17 +61,15 @@ static int read_block(int fd, void *buf, unsigned long block,
 	return 0;
 }
 
-static int write_block(int fd, void *buf, unsigned long block,
-		unsigned long block_size)
+static int write_at(int fd, void *buf, unsigned long long offset,
+		unsigned long length)
 {
 	char		*b;
-	off64_t		offset;
 	unsigned long	remaining;
 	ssize_t		rc;
 
 	b		= buf;
-	offset		= block * block_size;
-	remaining	= block_size;
+	remaining	= length;
 
 	while (remaining > 0) {
 		rc = pwrite64(fd, b, remaining, offset);
@@ -92,8 +88,24 @@ static int write_block(int fd, void *buf, unsigned long block,
 	return 0;
 }
 
+static int read_block(int fd, void *buf, unsigned long block,
+		unsigned long block_size)
+{
+	return read_at(fd, buf, (unsigned long long) block * block_size,
+			block_size);
+}
+
+static int write_block(int fd, void *buf, unsigned long block,
+		unsigned long block_size)
+{
+	return write_at(fd, buf, (unsigned long long) block * block_size,
+			block_size);
+}
+
 struct ioengine psync_engine  = {
 	.name		= "psync",
 	.read_block	= read_block,
 	.write_block	= write_block,
+	.read_at	= read_at,
+	.write_at	= write_at,
 };
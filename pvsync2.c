@@ -0,0 +1,220 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#define _GNU_SOURCE
+#define _LARGEFILE64_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <limits.h>
+#include "ioengine.h"
+
+#ifndef RWF_HIPRI
+#define RWF_HIPRI	0x00000001
+#endif
+#ifndef RWF_DSYNC
+#define RWF_DSYNC	0x00000002
+#endif
+#ifndef RWF_NOWAIT
+#define RWF_NOWAIT	0x00000008
+#endif
+
+#ifndef IOV_MAX
+#define IOV_MAX		1024
+#endif
+
+enum {
+	PV_STAT_CALLS,		/* preadv2/pwritev2 calls */
+	PV_STAT_BLOCKS,		/* blocks transferred */
+	PV_STAT_EAGAIN,		/* RWF_NOWAIT retried without the flag */
+};
+
+static int			rw_flags;
+static struct engine_stats	*stats;
+static struct iovec		iovs[IOV_MAX];
+
+static int pv_init(struct ioengine *e, struct ioengine_options *o)
+{
+	if (o->populate || o->hugepage || o->advice >= 0) {
+		fprintf(stderr, "pvsync2 does not support mmap options.\n");
+		return -1;
+	}
+
+	rw_flags = 0;
+	if (o->hipri)
+		rw_flags |= RWF_HIPRI;
+	if (o->nowait)
+		rw_flags |= RWF_NOWAIT;
+	if (o->dsync)
+		rw_flags |= RWF_DSYNC;
+	return 0;
+}
+
+static int pv_open(int fd, unsigned long long offset,
+		unsigned long long length, struct engine_stats *st)
+{
+	stats = st;
+	return 0;
+}
+
+static int do_rw(int fd, struct iovec *iov, int cnt, off64_t offset,
+		int write)
+{
+	ssize_t	rc;
+	int	flags;
+
+	flags = rw_flags;
+	while (cnt > 0) {
+		if (write)
+			rc = pwritev2(fd, iov, cnt, offset, flags);
+		else
+			rc = preadv2(fd, iov, cnt, offset, flags);
+
+		if (stats)
+			stats->val[PV_STAT_CALLS]++;
+
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+
+			if (errno == EAGAIN && (flags & RWF_NOWAIT)) {
+				/* would block, issue it again as a blocking IO */
+				if (stats)
+					stats->val[PV_STAT_EAGAIN]++;
+				flags &= ~RWF_NOWAIT;
+				continue;
+			}
+
+			fprintf(stderr, "%s failed: %s\n",
+					write ? "pwritev2" : "preadv2",
+					strerror(errno));
+			return -1;
+		}
+
+		if (rc == 0) {
+			fprintf(stderr, "%s failed: unexpected end of file\n",
+					write ? "pwritev2" : "preadv2");
+			return -1;
+		}
+
+		flags   = rw_flags;
+		offset += rc;
+
+		/* skip completed vectors and trim a partially done one */
+		while (rc > 0) {
+			if (rc >= iov->iov_len) {
+				rc -= iov->iov_len;
+				iov++;
+				cnt--;
+			} else {
+				iov->iov_base = (char *) iov->iov_base + rc;
+				iov->iov_len -= rc;
+				rc = 0;
+			}
+		}
+	}
+	return 0;
+}
+
+static int read_at(int fd, void *buf, unsigned long long offset,
+		unsigned long length)
+{
+	struct iovec iov = { .iov_base = buf, .iov_len = length };
+
+	if (stats)
+		stats->val[PV_STAT_BLOCKS]++;
+	return do_rw(fd, &iov, 1, offset, 0);
+}
+
+static int write_at(int fd, void *buf, unsigned long long offset,
+		unsigned long length)
+{
+	struct iovec iov = { .iov_base = buf, .iov_len = length };
+
+	if (stats)
+		stats->val[PV_STAT_BLOCKS]++;
+	return do_rw(fd, &iov, 1, offset, 1);
+}
+
+static int read_block(int fd, void *buf, unsigned long block,
+		unsigned long block_size)
+{
+	return read_at(fd, buf, (unsigned long long) block * block_size,
+			block_size);
+}
+
+static int write_block(int fd, void *buf, unsigned long block,
+		unsigned long block_size)
+{
+	return write_at(fd, buf, (unsigned long long) block * block_size,
+			block_size);
+}
+
+/*
+ * Runs of contiguous blocks are written with a single pwritev2, each iovec
+ * pointing at the same source buffer.
+ */
+static int write_blocks(int fd, void *buf, unsigned long *blocks, int nr,
+		unsigned long block_size)
+{
+	int	i;
+	int	cnt;
+
+	for (i = 0; i < nr; i += cnt) {
+		cnt = 0;
+		do {
+			iovs[cnt].iov_base = buf;
+			iovs[cnt].iov_len  = block_size;
+			cnt++;
+		} while (i + cnt < nr && cnt < IOV_MAX &&
+				blocks[i + cnt] == blocks[i + cnt - 1] + 1);
+
+		if (stats)
+			stats->val[PV_STAT_BLOCKS] += cnt;
+
+		if (do_rw(fd, iovs, cnt, (off64_t) blocks[i] * block_size, 1) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+struct ioengine pvsync2_engine = {
+	.name		= "pvsync2",
+	.init		= pv_init,
+	.open		= pv_open,
+	.read_block	= read_block,
+	.write_block	= write_block,
+	.write_blocks	= write_blocks,
+	.read_at	= read_at,
+	.write_at	= write_at,
+	.stat_names	= {
+		[PV_STAT_CALLS]		= "syscalls",
+		[PV_STAT_BLOCKS]	= "blocks",
+		[PV_STAT_EAGAIN]	= "nowait_eagain",
+	},
+};
@@ -0,0 +1,496 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Multi tenant QoS: each job can run in a cgroup v2 group of its own with
+ * io.max limits and an io.weight, and with an IO priority class set by
+ * ioprio_set(). The groups are created under iob.<pid> in the cgroup root
+ * when any job asks for a limit or a weight, every job then gets a group
+ * so that the shares are comparable, and removed at the end of the run.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <mntent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+
+#include "iob.h"
+#include "jobfile.h"
+#include "diskstats.h"
+#include "qos.h"
+
+#define IOPRIO_CLASS_SHIFT	13
+#define IOPRIO_WHO_PROCESS	1
+#define IO_WEIGHT_DEFAULT	100
+
+static const char *io_max_keys[IO_MAX_KEYS] = {
+	[IO_MAX_RBPS]	= "rbps",
+	[IO_MAX_WBPS]	= "wbps",
+	[IO_MAX_RIOPS]	= "riops",
+	[IO_MAX_WIOPS]	= "wiops",
+};
+
+static const char *ioprio_classes[] = { "none", "rt", "be", "idle" };
+
+/* rbps=<bytes>,wbps=<bytes>,riops=<n>,wiops=<n>, max or 0 for no limit */
+int parse_io_max(const char *str, struct job *job)
+{
+	char			buf[256];
+	char			*s, *save, *val, *end;
+	unsigned long long	v;
+	int			i;
+
+	if (strlen(str) >= sizeof(buf))
+		return -1;
+	strcpy(buf, str);
+
+	for (s = strtok_r(buf, ",", &save); s; s = strtok_r(NULL, ",", &save)) {
+		val = strchr(s, '=');
+		if (!val)
+			return -1;
+		*val++ = 0;
+
+		for (i = 0; i < IO_MAX_KEYS; i++)
+			if (!strcmp(ini_strip(s), io_max_keys[i]))
+				break;
+		if (i == IO_MAX_KEYS)
+			return -1;
+
+		val = ini_strip(val);
+		if (!strcmp(val, "max")) {
+			v = 0;
+		} else if (i == IO_MAX_RIOPS || i == IO_MAX_WIOPS) {
+			/* a count, 1k would be 1024 with a size suffix */
+			errno = 0;
+			v = strtoull(val, &end, 10);
+			if (errno || end == val || *end)
+				return -1;
+		} else if (parse_size(val, &v) < 0) {
+			return -1;
+		}
+		job->io_max[i] = v;
+	}
+	return 0;
+}
+
+/* rt[:level], be[:level] or idle, the level is 0 (highest) to 7 */
+int parse_ioprio(const char *str, int *ioprio)
+{
+	const char	*level;
+	char		*end;
+	size_t		len;
+	int		class;
+	long		l;
+
+	level = strchr(str, ':');
+	len   = level ? level - str : strlen(str);
+
+	for (class = 1; class < 4; class++)
+		if (strlen(ioprio_classes[class]) == len &&
+				!strncmp(str, ioprio_classes[class], len))
+			break;
+	if (class == 4)
+		return -1;
+
+	l = 4;
+	if (level) {
+		l = strtol(level + 1, &end, 10);
+		if (end == level + 1 || *end || l < 0 || l > 7 || class == 3)
+			return -1;
+	}
+	if (class == 3)
+		l = 0;
+
+	*ioprio = class << IOPRIO_CLASS_SHIFT | l;
+	return 0;
+}
+
+static int job_has_cgroup(struct job *job)
+{
+	int i;
+
+	for (i = 0; i < IO_MAX_KEYS; i++)
+		if (job->io_max[i])
+			return 1;
+	return job->io_weight != 0;
+}
+
+static int cg_write(const char *dir, const char *file, const char *val)
+{
+	char	path[PATH_MAX];
+	FILE	*fp;
+	int	rc;
+
+	if (snprintf(path, sizeof(path), "%s/%s", dir, file) >=
+			(int) sizeof(path)) {
+		fprintf(stderr, "%s/%s: path too long\n", dir, file);
+		return -1;
+	}
+	fp = fopen(path, "w");
+	if (!fp) {
+		fprintf(stderr, "open(%s) failed: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	/* cgroup files report errors on the write itself */
+	rc = fputs(val, fp) < 0 || fflush(fp) ? -1 : 0;
+	if (fclose(fp))
+		rc = -1;
+	if (rc < 0)
+		fprintf(stderr, "writing \"%s\" to %s failed: %s\n", val, path,
+				strerror(errno));
+	return rc;
+}
+
+static int cg_has(const char *dir, const char *file, const char *word)
+{
+	char	path[PATH_MAX];
+	char	buf[512];
+	char	*s, *save;
+	FILE	*fp;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, file);
+	fp = fopen(path, "r");
+	if (!fp)
+		return 0;
+	if (!fgets(buf, sizeof(buf), fp))
+		buf[0] = 0;
+	fclose(fp);
+
+	for (s = strtok_r(buf, " \n", &save); s; s = strtok_r(NULL, " \n", &save))
+		if (!strcmp(s, word))
+			return 1;
+	return 0;
+}
+
+static int cg_root(char *root, size_t len)
+{
+	struct mntent	*m;
+	FILE		*fp;
+
+	fp = setmntent("/proc/self/mounts", "r");
+	if (!fp)
+		return -1;
+
+	while ((m = getmntent(fp))) {
+		if (!strcmp(m->mnt_type, "cgroup2")) {
+			snprintf(root, len, "%s", m->mnt_dir);
+			endmntent(fp);
+			return 0;
+		}
+	}
+	endmntent(fp);
+	return -1;
+}
+
+static int job_cgroup(struct qos *q, int j, char *dir, size_t len)
+{
+	if (snprintf(dir, len, "%s/job%d", q->base, j) >= (int) len) {
+		fprintf(stderr, "%s/job%d: path too long\n", q->base, j);
+		return -1;
+	}
+	return 0;
+}
+
+static int job_limits(struct qos *q, struct job *job, int j)
+{
+	char	dir[PATH_MAX];
+	char	buf[256];
+	dev_t	dev;
+	int	n, i;
+
+	if (job_cgroup(q, j, dir, sizeof(dir)) < 0)
+		return -1;
+
+	if (job->io_weight) {
+		snprintf(buf, sizeof(buf), "default %u", job->io_weight);
+		if (cg_write(dir, "io.weight", buf) < 0)
+			return -1;
+	}
+
+	for (i = 0; i < IO_MAX_KEYS; i++)
+		if (job->io_max[i])
+			break;
+	if (i == IO_MAX_KEYS)
+		return 0;
+
+	if (disk_whole(job->path, &dev) < 0) {
+		fprintf(stderr, "%s: no block device for io.max.\n", job->name);
+		return -1;
+	}
+
+	n = snprintf(buf, sizeof(buf), "%u:%u", major(dev), minor(dev));
+	for (i = 0; i < IO_MAX_KEYS; i++) {
+		if (job->io_max[i])
+			n += snprintf(buf + n, sizeof(buf) - n, " %s=%llu",
+					io_max_keys[i], job->io_max[i]);
+		else
+			n += snprintf(buf + n, sizeof(buf) - n, " %s=max",
+					io_max_keys[i]);
+	}
+	return cg_write(dir, "io.max", buf);
+}
+
+int qos_setup(struct run *r, const char *root)
+{
+	struct qos	*q;
+	char		dir[PATH_MAX];
+	char		buf[PATH_MAX];
+	int		j;
+
+	for (j = 0; j < r->no_jobs; j++)
+		if (job_has_cgroup(&r->jobs[j]))
+			break;
+	if (j == r->no_jobs)
+		return 0;
+
+	if (!root) {
+		if (cg_root(buf, sizeof(buf)) < 0) {
+			fprintf(stderr, "cgroup v2 is not mounted.\n");
+			return -1;
+		}
+		root = buf;
+	}
+
+	if (!cg_has(root, "cgroup.controllers", "io")) {
+		fprintf(stderr, "io controller not available in %s.\n", root);
+		return -1;
+	}
+
+	if (!cg_has(root, "cgroup.subtree_control", "io") &&
+			cg_write(root, "cgroup.subtree_control", "+io") < 0)
+		return -1;
+
+	q = calloc(1, sizeof(*q));
+	if (q)
+		q->created = calloc(r->no_jobs, sizeof(*q->created));
+	if (!q || !q->created) {
+		fprintf(stderr, "Memory Allocation Failed.\n");
+		free(q);
+		return -1;
+	}
+	q->no_jobs = r->no_jobs;
+	r->qos     = q;
+
+	if (snprintf(q->base, sizeof(q->base), "%s/iob.%d", root,
+				getpid()) >= (int) sizeof(q->base)) {
+		fprintf(stderr, "%s: path too long\n", root);
+		q->base[0] = 0;
+		return -1;
+	}
+	if (mkdir(q->base, 0755) < 0) {
+		fprintf(stderr, "mkdir(%s) failed: %s\n", q->base,
+				strerror(errno));
+		q->base[0] = 0;
+		return -1;
+	}
+
+	if (cg_write(q->base, "cgroup.subtree_control", "+io") < 0)
+		return -1;
+
+	for (j = 0; j < r->no_jobs; j++) {
+		if (job_cgroup(q, j, dir, sizeof(dir)) < 0)
+			return -1;
+		if (mkdir(dir, 0755) < 0) {
+			fprintf(stderr, "mkdir(%s) failed: %s\n", dir,
+					strerror(errno));
+			return -1;
+		}
+		q->created[j] = 1;
+
+		if (job_limits(q, &r->jobs[j], j) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+/* called by each worker before it starts IO */
+int qos_enter(struct run *r, int j)
+{
+	struct job	*job = &r->jobs[j];
+	char		dir[PATH_MAX];
+
+	if (r->qos) {
+		if (job_cgroup(r->qos, j, dir, sizeof(dir)) < 0 ||
+				cg_write(dir, "cgroup.procs", "0") < 0)
+			return -1;
+	}
+
+	if (job->ioprio && syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+				job->ioprio) < 0) {
+		fprintf(stderr, "%s: ioprio_set failed: %s\n", job->name,
+				strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+static void cg_rmdir(const char *dir)
+{
+	int i;
+
+	/* exited workers may take a moment to leave the group */
+	for (i = 0; i < 100 && rmdir(dir) < 0 && errno == EBUSY; i++)
+		usleep(10000);
+}
+
+void qos_cleanup(struct run *r)
+{
+	struct qos	*q = r->qos;
+	char		dir[PATH_MAX];
+	int		j;
+
+	if (!q)
+		return;
+
+	for (j = 0; j < q->no_jobs; j++) {
+		if (!q->created[j] || job_cgroup(q, j, dir, sizeof(dir)) < 0)
+			continue;
+		cg_rmdir(dir);
+	}
+	if (q->base[0])
+		cg_rmdir(q->base);
+
+	free(q->created);
+	free(q);
+	r->qos = NULL;
+}
+
+/* achieved rates and tail latency of job j */
+static void job_rates(struct run *r, int j, double *bps, double *iops,
+		double rate[IO_MAX_KEYS], struct lat_hist *h)
+{
+	struct result_data	*rd;
+	struct job		*job = &r->jobs[j];
+	double			secs;
+	int			i, k;
+
+	*bps  = 0;
+	*iops = 0;
+	memset(rate, 0, sizeof(*rate) * IO_MAX_KEYS);
+	lat_hist_init(h);
+
+	rd = r->results;
+	for (k = 0; k < j; k++)
+		rd += r->jobs[k].procs;
+
+	for (i = 0; i < job->procs; i++, rd++) {
+		lat_hist_merge(h, &rd->read_hist);
+		lat_hist_merge(h, &rd->write_hist);
+		if (rd->end_ns <= rd->start_ns)
+			continue;
+
+		secs = (double) (rd->end_ns - rd->start_ns) / SEC_TO_NS;
+		rate[IO_MAX_RIOPS] += rd->reads / secs;
+		rate[IO_MAX_WIOPS] += rd->writes / secs;
+	}
+	rate[IO_MAX_RBPS] = rate[IO_MAX_RIOPS] * job->block_size;
+	rate[IO_MAX_WBPS] = rate[IO_MAX_WIOPS] * job->block_size;
+	*iops = rate[IO_MAX_RIOPS] + rate[IO_MAX_WIOPS];
+	*bps  = rate[IO_MAX_RBPS] + rate[IO_MAX_WBPS];
+}
+
+void qos_report(struct run *r, FILE *fp)
+{
+	struct job		*job;
+	struct lat_hist		h;
+	double			rate[IO_MAX_KEYS];
+	double			bps, iops, dev_bps, other_bps, other_iops;
+	double			scratch[IO_MAX_KEYS];
+	struct lat_hist		scratch_h;
+	unsigned int		weight, dev_weight;
+	char			prio[16];
+	dev_t			*devs;
+	int			j, k, i;
+
+	for (j = 0; j < r->no_jobs; j++)
+		if (job_has_cgroup(&r->jobs[j]) || r->jobs[j].ioprio)
+			break;
+	if (j == r->no_jobs)
+		return;
+
+	/* jobs on the same disk compete for it, files on it included */
+	devs = calloc(r->no_jobs, sizeof(*devs));
+	if (!devs)
+		return;
+	for (j = 0; j < r->no_jobs; j++)
+		if (disk_whole(r->jobs[j].path, &devs[j]) < 0)
+			devs[j] = 0;
+
+	fprintf(fp, "\nQoS:\n%-16s %-7s %6s %10s %10s %9s %9s %10s %10s\n",
+			"job", "ioprio", "weight", "MB/s", "IOPS", "share cfg",
+			"share got", "p99 us", "p99.9 us");
+
+	for (j = 0; j < r->no_jobs; j++) {
+		job = &r->jobs[j];
+		job_rates(r, j, &bps, &iops, rate, &h);
+
+		weight     = job->io_weight ? job->io_weight : IO_WEIGHT_DEFAULT;
+		dev_weight = 0;
+		dev_bps    = 0;
+		for (k = 0; k < r->no_jobs; k++) {
+			if (devs[j] ? devs[k] != devs[j] :
+					r->jobs[k].dev_index != job->dev_index)
+				continue;
+			dev_weight += r->jobs[k].io_weight ?
+				r->jobs[k].io_weight : IO_WEIGHT_DEFAULT;
+			job_rates(r, k, &other_bps, &other_iops, scratch,
+					&scratch_h);
+			dev_bps += other_bps;
+		}
+
+		if ((job->ioprio >> IOPRIO_CLASS_SHIFT) == 3)
+			strcpy(prio, "idle");
+		else if (job->ioprio)
+			snprintf(prio, sizeof(prio), "%s:%d",
+					ioprio_classes[job->ioprio >> IOPRIO_CLASS_SHIFT],
+					job->ioprio & ((1 << IOPRIO_CLASS_SHIFT) - 1));
+		else
+			strcpy(prio, "-");
+
+		fprintf(fp, "%-16.16s %-7s %6u %10.2f %10.0f %8.1f%% %8.1f%% "
+				"%10.1f %10.1f\n", job->name, prio, weight,
+				bps / (1024 * 1024), iops,
+				100.0 * weight / dev_weight,
+				dev_bps ? 100.0 * bps / dev_bps : 0,
+				lat_hist_percentile(&h, 99.0) / 1000.0,
+				lat_hist_percentile(&h, 99.9) / 1000.0);
+
+		for (i = 0; i < IO_MAX_KEYS; i++) {
+			if (!job->io_max[i])
+				continue;
+			fprintf(fp, "%-16s io.max %s = %llu, achieved %.0f "
+					"(%.1f%%)\n", "", io_max_keys[i],
+					job->io_max[i], rate[i],
+					100.0 * rate[i] / job->io_max[i]);
+		}
+	}
+	free(devs);
+}
@@ -0,0 +1,61 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __QOS_H__
+#define __QOS_H__
+
+#include <stdio.h>
+#include <limits.h>
+
+struct job;
+struct run;
+
+/* cgroup v2 io.max keys, in the order of struct job io_max */
+enum {
+	IO_MAX_RBPS,
+	IO_MAX_WBPS,
+	IO_MAX_RIOPS,
+	IO_MAX_WIOPS,
+	IO_MAX_KEYS,
+};
+
+/* cgroups iob created for the jobs of a run */
+struct qos {
+	char	base[PATH_MAX];		/* iob.<pid> */
+	int	*created;		/* by job, job group exists */
+	int	no_jobs;
+};
+
+int parse_io_max(const char *str, struct job *job);
+
+int parse_ioprio(const char *str, int *ioprio);
+
+int qos_setup(struct run *r, const char *root);
+
+int qos_enter(struct run *r, int job);
+
+void qos_cleanup(struct run *r);
+
+void qos_report(struct run *r, FILE *fp);
+
+#endif
@@ -0,0 +1,211 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <errno.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "iob.h"
+#include "random.h"
+#include "ioengine.h"
+#include "selfbench.h"
+
+extern struct ioengine null_engine;
+
+enum sb_stage {
+	SB_CLOCK,	/* get_hrtime() */
+	SB_ENGINE,	/* indirect call into the null engine */
+	SB_FILL,	/* fill_random_buffer() of one block */
+	SB_OFFSET,	/* next block number */
+	SB_IO,		/* do_io() with the null engine */
+	SB_STAGES,
+};
+
+static const char *sb_stage_names[SB_STAGES] = {
+	[SB_CLOCK]	= "clock",
+	[SB_ENGINE]	= "engine",
+	[SB_FILL]	= "fill",
+	[SB_OFFSET]	= "offset",
+	[SB_IO]		= "io",
+};
+
+struct sb_result {
+	unsigned long long	ns[SB_STAGES];
+	unsigned long		ops[SB_STAGES];
+};
+
+/* keeps the compiler from resolving the engine call at build time */
+static struct ioengine * volatile sb_engine = &null_engine;
+
+/* every stage is timed in thread CPU time, like the io stage */
+#define SB_CPU_CLOCK	CLOCK_THREAD_CPUTIME_ID
+
+static void sb_worker(unsigned long block_size, unsigned long ops,
+		int random, int clk_id, struct sb_result *r)
+{
+	struct ioengine		*ioengine = sb_engine;
+	struct rand_range	ir;
+	unsigned long long	s;
+	long long		io_ns;
+	volatile unsigned long	sink;
+	unsigned long		fill_ops;
+	unsigned long		i;
+	char			*buf;
+
+	buf = memalign(IO_BLOCK_SIZE, block_size);
+	if (!buf)
+		exit(1);
+
+	init_rand_range(&ir, 0, ops - 1);
+
+	s = get_hrtime(SB_CPU_CLOCK);
+	for (i = 0; i < ops; i++)
+		sink = get_hrtime(clk_id);
+	r->ns[SB_CLOCK]  = get_hrtime(SB_CPU_CLOCK) - s;
+	r->ops[SB_CLOCK] = ops;
+
+	s = get_hrtime(SB_CPU_CLOCK);
+	for (i = 0; i < ops; i++)
+		ioengine->write_block(-1, buf, i, block_size);
+	r->ns[SB_ENGINE]  = get_hrtime(SB_CPU_CLOCK) - s;
+	r->ops[SB_ENGINE] = ops;
+
+	/* reading /dev/urandom is slow, a fraction of ops is plenty */
+	fill_ops = MAX(ops / 1024, 1);
+	s = get_hrtime(SB_CPU_CLOCK);
+	for (i = 0; i < fill_ops; i++)
+		fill_random_buffer(buf, block_size);
+	r->ns[SB_FILL]  = get_hrtime(SB_CPU_CLOCK) - s;
+	r->ops[SB_FILL] = fill_ops;
+
+	s = get_hrtime(SB_CPU_CLOCK);
+	for (i = 0; i < ops; i++)
+		sink = random ? get_random_range(&ir) : i;
+	r->ns[SB_OFFSET]  = get_hrtime(SB_CPU_CLOCK) - s;
+	r->ops[SB_OFFSET] = ops;
+
+	(void) sink;
+	free(buf);
+
+	/* the real IO loop; CPU time leaves out preemption and other workers */
+	io_ns = null_io_cpu_ns(block_size, ops, random, clk_id);
+	if (io_ns < 0)
+		exit(1);
+	r->ns[SB_IO]  = io_ns;
+	r->ops[SB_IO] = ops;
+}
+
+static void sb_report(int procs, struct sb_result *results)
+{
+	struct sb_result	*r;
+	double			per_op;
+	double			total_iops;
+	int			i, st;
+
+	printf("\n%-8s", "worker");
+	for (st = 0; st < SB_STAGES; st++)
+		printf(" %10s", sb_stage_names[st]);
+	printf(" %12s\n", "max IOPS");
+
+	total_iops = 0;
+	for (i = 0; i < procs; i++) {
+		r = &results[i];
+		printf("%-8d", i);
+		for (st = 0; st < SB_STAGES; st++) {
+			per_op = r->ops[st] ? (double) r->ns[st] / r->ops[st] : 0;
+			printf(" %10.1f", per_op);
+		}
+
+		per_op = r->ops[SB_IO] ? (double) r->ns[SB_IO] / r->ops[SB_IO] : 0;
+		if (per_op > 0) {
+			printf(" %12.0f", SEC_TO_NS / per_op);
+			total_iops += SEC_TO_NS / per_op;
+		}
+		printf("\n");
+	}
+
+	printf("\nStage costs are thread CPU ns per call, fill is per block "
+			"of data.\n");
+	printf("io is per IO of the worker read loop with the null engine,\n"
+			"clock reads, histograms and offsets included; "
+			"max IOPS is its inverse.\n");
+	printf("Harness IOPS ceiling = %.0f\n", total_iops);
+}
+
+int selfbench_run(int procs, unsigned long block_size, unsigned long ops,
+		int random, int clk_id)
+{
+	struct sb_result	*results;
+	pid_t			*pids;
+	pid_t			pid;
+	int			i, n;
+	int			status;
+	int			failed;
+
+	results = alloc_shared(sizeof(*results) * procs);
+	pids    = calloc(procs, sizeof(*pids));
+	if (!results || !pids) {
+		fprintf(stderr, "Memory Allocation Failed.\n");
+		return 1;
+	}
+
+	printf("Self benchmark: %lu ops per stage, %d workers\n", ops, procs);
+	fflush(stdout);
+
+	n = 0;
+	for (i = 0; i < procs; i++) {
+		pid = fork();
+		if (pid < 0) {
+			fprintf(stderr, "fork failed: %s\n", strerror(errno));
+			break;
+		} else if (pid) {
+			pids[n++] = pid;
+			continue;
+		}
+
+		/* child process */
+		sb_worker(block_size, ops, random, clk_id, &results[i]);
+		exit(0);
+	}
+
+	failed = 0;
+	for (i = 0; i < n; i++) {
+		waitpid(pids[i], &status, 0);
+		if (!WIFEXITED(status) || WEXITSTATUS(status))
+			failed = 1;
+	}
+
+	sb_report(n, results);
+
+	free(pids);
+	free_shared(results);
+	return failed;
+}
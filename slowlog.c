@@ -0,0 +1,134 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "iob.h"
+#include "slowlog.h"
+
+struct slow_ring *slow_ring_alloc(unsigned int size)
+{
+	struct slow_ring *ring;
+
+	ring = alloc_shared(sizeof(*ring) + size * sizeof(ring->e[0]));
+	if (!ring)
+		return NULL;
+
+	ring->size = size;
+	return ring;
+}
+
+void slow_ring_free(struct slow_ring *ring)
+{
+	if (ring)
+		free_shared(ring);
+}
+
+void slow_ring_record(struct slow_ring *ring, struct slow_entry *e)
+{
+	struct slow_entry	*slot;
+	uint64_t		idx;
+
+	idx  = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED);
+	slot = &ring->e[idx % ring->size];
+
+	/* seqlock style: invalidate, fill, publish */
+	__atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	slot->issue_ns   = e->issue_ns;
+	slot->latency_ns = e->latency_ns;
+	slot->offset     = e->offset;
+	slot->size       = e->size;
+	slot->inflight   = e->inflight;
+	slot->job        = e->job;
+	slot->worker     = e->worker;
+	slot->cpu        = e->cpu;
+	slot->write      = e->write;
+
+	__atomic_store_n(&slot->seq, idx + 1, __ATOMIC_RELEASE);
+}
+
+static int slow_ring_read(struct slow_ring *ring, uint64_t idx,
+		struct slow_entry *e)
+{
+	struct slow_entry *slot = &ring->e[idx % ring->size];
+
+	if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != idx + 1)
+		return -1;
+
+	memcpy(e, slot, sizeof(*e));
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != idx + 1)
+		return -1;
+	return 0;
+}
+
+void slow_ring_dump(struct slow_ring *ring, struct run *r, FILE *fp)
+{
+	struct slow_entry	e;
+	struct timespec		ts;
+	struct tm		tm;
+	unsigned long long	wall;
+	uint64_t		head;
+	uint64_t		idx;
+	char			buf[32];
+
+	head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	idx  = head > ring->size ? head - ring->size : 0;
+
+	fprintf(fp, "\nSlow IOs: %llu recorded, %llu dropped\n",
+			(unsigned long long) head, (unsigned long long) idx);
+	if (head == idx)
+		return;
+
+	fprintf(fp, "%-29s %12s %-5s %14s %8s %-16s %6s %4s %8s\n", "time",
+			"latency_ns", "op", "offset", "size", "job", "worker",
+			"cpu", "inflight");
+
+	for (; idx < head; idx++) {
+		if (slow_ring_read(ring, idx, &e) < 0)
+			continue;
+
+		/* issue time on the wall clock */
+		wall = r->wall_start + (e.issue_ns - r->clock_start);
+		ts.tv_sec  = wall / SEC_TO_NS;
+		ts.tv_nsec = wall % SEC_TO_NS;
+		localtime_r(&ts.tv_sec, &tm);
+		strftime(buf, sizeof(buf), "%F %T", &tm);
+
+		fprintf(fp, "%s.%09ld %12llu %-5s %14llu %8u %-16.16s %6d %4d %8u\n",
+				buf, ts.tv_nsec,
+				(unsigned long long) e.latency_ns,
+				e.write ? "write" : "read",
+				(unsigned long long) e.offset, e.size,
+				e.job < r->no_jobs ? r->jobs[e.job].name : "?",
+				e.worker, e.cpu, e.inflight);
+	}
+	fflush(fp);
+}
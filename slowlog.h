@@ -0,0 +1,64 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __SLOWLOG_H__
+#define __SLOWLOG_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+struct run;
+
+struct slow_entry {
+	uint64_t	seq;		/* index + 1 once complete, 0 while written */
+	uint64_t	issue_ns;	/* run clock */
+	uint64_t	latency_ns;
+	uint64_t	offset;		/* bytes */
+	uint32_t	size;		/* bytes */
+	uint32_t	inflight;	/* IOs in flight on the path at issue */
+	int32_t		job;
+	int32_t		worker;
+	int32_t		cpu;
+	int32_t		write;
+};
+
+/*
+ * Lock free ring in shared memory, written by all workers of a run. Once
+ * full the oldest entries are overwritten, so the most recent slow IOs are
+ * kept; the reader skips entries that are being overwritten.
+ */
+struct slow_ring {
+	uint64_t		head;		/* entries ever recorded */
+	uint32_t		size;
+	struct slow_entry	e[];
+};
+
+struct slow_ring *slow_ring_alloc(unsigned int size);
+
+void slow_ring_free(struct slow_ring *ring);
+
+void slow_ring_record(struct slow_ring *ring, struct slow_entry *e);
+
+void slow_ring_dump(struct slow_ring *ring, struct run *r, FILE *fp);
+
+#endif
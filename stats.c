@@ -0,0 +1,170 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "stats.h"
+
+void lat_hist_init(struct lat_hist *h)
+{
+	memset(h, 0, sizeof(*h));
+}
+
+static int lat_hist_index(unsigned long long ns)
+{
+	int msb;
+	int group;
+	int sub;
+
+	if (ns < LAT_HIST_SUB)
+		return (int) ns;
+
+	msb   = 63 - __builtin_clzll(ns);
+	group = msb - LAT_HIST_SUB_BITS + 1;
+	sub   = (ns >> (msb - LAT_HIST_SUB_BITS)) & (LAT_HIST_SUB - 1);
+
+	if (group >= LAT_HIST_GROUPS)
+		return LAT_HIST_BUCKETS - 1;
+	return group * LAT_HIST_SUB + sub;
+}
+
+static unsigned long long lat_hist_bucket_lower(int index)
+{
+	int group;
+	int sub;
+
+	if (index < LAT_HIST_SUB)
+		return index;
+
+	group = index / LAT_HIST_SUB;
+	sub   = index % LAT_HIST_SUB;
+	return (unsigned long long) (LAT_HIST_SUB + sub) << (group - 1);
+}
+
+unsigned long long lat_hist_bucket_upper(int index)
+{
+	if (index < LAT_HIST_SUB)
+		return index;
+
+	return lat_hist_bucket_lower(index) +
+		(1ULL << (index / LAT_HIST_SUB - 1)) - 1;
+}
+
+void lat_hist_add(struct lat_hist *h, unsigned long long ns)
+{
+	if (!h->count || ns < h->min)
+		h->min = ns;
+	if (ns > h->max)
+		h->max = ns;
+
+	h->count++;
+	h->sum += ns;
+	h->buckets[lat_hist_index(ns)]++;
+}
+
+/* n samples of ns each, e.g. the IOs of one batch */
+void lat_hist_add_n(struct lat_hist *h, unsigned long long ns,
+		unsigned long n)
+{
+	if (!n)
+		return;
+
+	if (!h->count || ns < h->min)
+		h->min = ns;
+	if (ns > h->max)
+		h->max = ns;
+
+	h->count += n;
+	h->sum += ns * n;
+	h->buckets[lat_hist_index(ns)] += n;
+}
+
+void lat_hist_merge(struct lat_hist *dst, const struct lat_hist *src)
+{
+	int i;
+
+	if (!src->count)
+		return;
+
+	if (!dst->count || src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+
+	dst->count += src->count;
+	dst->sum   += src->sum;
+	for (i = 0; i < LAT_HIST_BUCKETS; i++)
+		dst->buckets[i] += src->buckets[i];
+}
+
+unsigned long long lat_hist_percentile(const struct lat_hist *h, double pct)
+{
+	unsigned long long	rank;
+	unsigned long long	seen;
+	unsigned long long	lo, hi;
+	int			i;
+
+	if (!h->count)
+		return 0;
+
+	rank = (unsigned long long) (pct / 100.0 * h->count + 0.5);
+	if (rank < 1)
+		rank = 1;
+	if (rank > h->count)
+		rank = h->count;
+
+	seen = 0;
+	for (i = 0; i < LAT_HIST_BUCKETS; i++) {
+		seen += h->buckets[i];
+		if (seen < rank)
+			continue;
+
+		/* report the middle of the bucket, clamped to what was seen */
+		lo = lat_hist_bucket_lower(i);
+		hi = lat_hist_bucket_upper(i);
+		lo = lo + (hi - lo) / 2;
+		if (lo < h->min)
+			lo = h->min;
+		if (lo > h->max)
+			lo = h->max;
+		return lo;
+	}
+	return h->max;
+}
+
+void lat_hist_print(const char *label, const struct lat_hist *h)
+{
+	if (!h->count) {
+		printf("%-8s: no samples\n", label);
+		return;
+	}
+
+	printf("%-8s: lat (ns) min = %llu, avg = %llu, max = %llu\n", label,
+			h->min, h->sum / h->count, h->max);
+	printf("%-8s  p50 = %llu, p90 = %llu, p99 = %llu, p99.9 = %llu\n", "",
+			lat_hist_percentile(h, 50.0),
+			lat_hist_percentile(h, 90.0),
+			lat_hist_percentile(h, 99.0),
+			lat_hist_percentile(h, 99.9));
+}
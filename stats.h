@@ -0,0 +1,60 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+/*
+ * Latency histogram with log-linear buckets: every power of two is split
+ * into LAT_HIST_SUB linear buckets, which keeps the relative error of a
+ * percentile below 1/LAT_HIST_SUB regardless of the magnitude.
+ */
+#define LAT_HIST_SUB_BITS	3
+#define LAT_HIST_SUB		(1 << LAT_HIST_SUB_BITS)
+#define LAT_HIST_GROUPS		40	/* up to ~2^42 ns, more than an hour */
+#define LAT_HIST_BUCKETS	(LAT_HIST_GROUPS * LAT_HIST_SUB)
+
+struct lat_hist {
+	unsigned long long	count;
+	unsigned long long	sum;		/* ns */
+	unsigned long long	min;		/* ns */
+	unsigned long long	max;		/* ns */
+	unsigned long long	buckets[LAT_HIST_BUCKETS];
+};
+
+void lat_hist_init(struct lat_hist *h);
+
+void lat_hist_add(struct lat_hist *h, unsigned long long ns);
+
+void lat_hist_add_n(struct lat_hist *h, unsigned long long ns,
+		unsigned long n);
+
+void lat_hist_merge(struct lat_hist *dst, const struct lat_hist *src);
+
+unsigned long long lat_hist_bucket_upper(int index);
+
+unsigned long long lat_hist_percentile(const struct lat_hist *h, double pct);
+
+void lat_hist_print(const char *label, const struct lat_hist *h);
+
+#endif
@@ -0,0 +1,452 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Benchmark suites: every combination of engine, block size, pattern and
+ * worker count is run on all PATHS, one after the other. Besides the built
+ * in "standard" suite, a suite can be read from a file:
+ *
+ *	[suite]
+ *	engines = sync,psync
+ *	block_sizes = 4k,64k,1m
+ *	patterns = seq,rand
+ *	workers = 1,2,4
+ *	runtime = 5
+ *	precondition = 1
+ *
+ * Patterns are write, randwrite, read or randread; seq and rand are short
+ * for write and randwrite.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include "iob.h"
+#include "jobfile.h"
+#include "suite.h"
+
+#define SUITE_MAX_VALUES	16
+#define SUITE_DEFAULT_RUNTIME	5
+
+enum suite_dim {
+	DIM_ENGINE,
+	DIM_BLOCK_SIZE,
+	DIM_PATTERN,
+	DIM_WORKERS,
+	DIMS,
+};
+
+static const char *dim_names[DIMS] = {
+	[DIM_ENGINE]		= "engine",
+	[DIM_BLOCK_SIZE]	= "block_size",
+	[DIM_PATTERN]		= "pattern",
+	[DIM_WORKERS]		= "workers",
+};
+
+struct suite {
+	char		*values[DIMS][SUITE_MAX_VALUES];
+	int		no_values[DIMS];
+	unsigned long	runtime;
+	int		precondition;
+};
+
+struct cell {
+	int			idx[DIMS];	/* value index per dimension */
+	int			failed;
+	double			iops;
+	double			mbps;
+	unsigned long long	lat_avg;	/* ns */
+	unsigned long long	lat_p99;	/* ns */
+};
+
+static int suite_set_list(struct suite *s, enum suite_dim dim, const char *val)
+{
+	char	*list, *tok, *save;
+
+	list = strdup(val);
+	if (!list)
+		return -1;
+
+	s->no_values[dim] = 0;
+	for (tok = strtok_r(list, ",", &save); tok;
+			tok = strtok_r(NULL, ",", &save)) {
+		tok = ini_strip(tok);
+		if (!*tok)
+			continue;
+		if (s->no_values[dim] == SUITE_MAX_VALUES) {
+			free(list);
+			return -1;
+		}
+		s->values[dim][s->no_values[dim]++] = strdup(tok);
+	}
+	free(list);
+	return s->no_values[dim] ? 0 : -1;
+}
+
+static int suite_standard(struct suite *s)
+{
+	s->runtime      = SUITE_DEFAULT_RUNTIME;
+	s->precondition = 1;
+
+	if (suite_set_list(s, DIM_ENGINE, "sync,psync") < 0 ||
+	    suite_set_list(s, DIM_BLOCK_SIZE, "4k,16k,64k,256k,1m") < 0 ||
+	    suite_set_list(s, DIM_PATTERN, "seq,rand") < 0 ||
+	    suite_set_list(s, DIM_WORKERS, "1,2,4,8") < 0)
+		return -1;
+	return 0;
+}
+
+static int suite_parse(struct suite *s, const char *path)
+{
+	FILE			*fp;
+	char			line[1024];
+	char			*key, *val;
+	unsigned long long	v;
+	int			lineno;
+	int			dim;
+	int			rc;
+
+	/* a file only needs to list the dimensions it changes */
+	if (suite_standard(s) < 0)
+		return -1;
+
+	fp = fopen(path, "r");
+	if (!fp) {
+		fprintf(stderr, "open(%s) failed: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	lineno = 0;
+	while (fgets(line, sizeof(line), fp)) {
+		lineno++;
+		key = ini_strip(line);
+		if (!*key || *key == '#' || *key == ';' || *key == '[')
+			continue;
+
+		val = strchr(key, '=');
+		if (!val)
+			goto syntax;
+		*val = 0;
+		key  = ini_strip(key);
+		val  = ini_strip(val + 1);
+
+		rc = -1;
+		if (!strcmp(key, "engines"))
+			rc = suite_set_list(s, DIM_ENGINE, val);
+		else if (!strcmp(key, "block_sizes"))
+			rc = suite_set_list(s, DIM_BLOCK_SIZE, val);
+		else if (!strcmp(key, "patterns"))
+			rc = suite_set_list(s, DIM_PATTERN, val);
+		else if (!strcmp(key, "workers"))
+			rc = suite_set_list(s, DIM_WORKERS, val);
+		else if (!strcmp(key, "runtime") && !parse_size(val, &v)) {
+			s->runtime = v;
+			rc = 0;
+		} else if (!strcmp(key, "precondition"))
+			rc = parse_bool(val, &s->precondition);
+
+		if (rc < 0)
+			goto syntax;
+	}
+	fclose(fp);
+
+	for (dim = 0; dim < DIMS; dim++)
+		if (!s->no_values[dim])
+			return -1;
+	return 0;
+
+syntax:
+	fprintf(stderr, "%s:%d: syntax error\n", path, lineno);
+	fclose(fp);
+	return -1;
+}
+
+/* applies the values of cell c to job */
+static int suite_job(struct suite *s, struct cell *c, struct job *job)
+{
+	const char		*pattern;
+	unsigned long long	bs;
+
+	if (!get_ioengine(s->values[DIM_ENGINE][c->idx[DIM_ENGINE]]))
+		return -1;
+	snprintf(job->engine, sizeof(job->engine), "%s",
+			s->values[DIM_ENGINE][c->idx[DIM_ENGINE]]);
+
+	if (parse_size(s->values[DIM_BLOCK_SIZE][c->idx[DIM_BLOCK_SIZE]], &bs) < 0)
+		return -1;
+	job->block_size = bs;
+
+	pattern = s->values[DIM_PATTERN][c->idx[DIM_PATTERN]];
+	if (!strcmp(pattern, "seq"))
+		pattern = "write";
+	else if (!strcmp(pattern, "rand"))
+		pattern = "randwrite";
+	if (parse_rw(pattern, job) < 0)
+		return -1;
+
+	job->procs = atoi(s->values[DIM_WORKERS][c->idx[DIM_WORKERS]]);
+	return 0;
+}
+
+/* the caller reads the results and calls run_free() */
+static int suite_one(struct run *r)
+{
+	if (run_prepare(r) < 0)
+		return -1;
+
+	if (run_start(r) < 0) {
+		run_abort(r);
+		return -1;
+	}
+
+	run_go(r);
+	return run_wait(r);
+}
+
+static void suite_cell_stats(struct run *r, struct cell *c)
+{
+	struct result_data	*rd;
+	struct lat_hist		h;
+	unsigned long long	ios;
+	int			i, j;
+
+	c->iops = 0;
+	c->mbps = 0;
+	lat_hist_init(&h);
+
+	rd = r->results;
+	for (j = 0; j < r->no_jobs; j++) {
+		for (i = 0; i < r->jobs[j].procs; i++, rd++) {
+			lat_hist_merge(&h, &rd->read_hist);
+			lat_hist_merge(&h, &rd->write_hist);
+			if (rd->end_ns <= rd->start_ns)
+				continue;
+
+			ios = rd->reads + rd->writes;
+			c->iops += (double) ios * SEC_TO_NS /
+				(rd->end_ns - rd->start_ns);
+			c->mbps += (double) ios * r->jobs[j].block_size *
+				SEC_TO_NS / (rd->end_ns - rd->start_ns) /
+				(1024 * 1024);
+		}
+	}
+
+	c->lat_avg = h.count ? h.sum / h.count : 0;
+	c->lat_p99 = lat_hist_percentile(&h, 99.0);
+}
+
+/* sequential write over the whole range of every path, once */
+static int suite_precondition(const struct job *tmpl, char **paths,
+		int no_paths, int clk_id)
+{
+	struct run	r;
+	int		i;
+	int		rc;
+
+	memset(&r, 0, sizeof(r));
+	r.jobs    = calloc(no_paths, sizeof(*r.jobs));
+	r.no_jobs = no_paths;
+	r.clk_id  = clk_id;
+	r.quiet   = 1;
+	if (!r.jobs)
+		return -1;
+
+	for (i = 0; i < no_paths; i++) {
+		r.jobs[i] = *tmpl;
+		snprintf(r.jobs[i].path, sizeof(r.jobs[i].path), "%s", paths[i]);
+		snprintf(r.jobs[i].name, sizeof(r.jobs[i].name), "%s", paths[i]);
+		strcpy(r.jobs[i].engine, "psync");
+		r.jobs[i].block_size = 1024 * 1024;
+		r.jobs[i].procs      = 1;
+		r.jobs[i].iterations = 1;
+		r.jobs[i].read       = 0;
+		r.jobs[i].random     = 0;
+		r.jobs[i].verify     = 0;
+	}
+
+	printf("Preconditioning %d paths\n", no_paths);
+	fflush(stdout);
+	rc = suite_one(&r);
+	run_free(&r);
+	free(r.jobs);
+	return rc;
+}
+
+static void suite_json(FILE *fp, struct suite *s, struct cell *cells,
+		int no_cells)
+{
+	struct cell	*c;
+	double		iops, mbps;
+	int		n;
+	int		dim, v, i, k;
+
+	fprintf(fp, "{\n  \"cells\": [\n");
+	for (i = 0; i < no_cells; i++) {
+		c = &cells[i];
+		fprintf(fp, "    {");
+		for (dim = 0; dim < DIMS; dim++)
+			fprintf(fp, "\"%s\": \"%s\", ", dim_names[dim],
+					s->values[dim][c->idx[dim]]);
+		if (c->failed)
+			fprintf(fp, "\"failed\": true}");
+		else
+			fprintf(fp, "\"iops\": %.0f, \"mbps\": %.2f, "
+					"\"lat_avg_ns\": %llu, \"lat_p99_ns\": %llu}",
+					c->iops, c->mbps, c->lat_avg, c->lat_p99);
+		fprintf(fp, "%s\n", i + 1 < no_cells ? "," : "");
+	}
+	fprintf(fp, "  ],\n");
+
+	/* mean over all other dimensions for each value of a dimension */
+	fprintf(fp, "  \"scaling\": {\n");
+	for (dim = 0; dim < DIMS; dim++) {
+		fprintf(fp, "    \"%s\": [", dim_names[dim]);
+		for (v = 0; v < s->no_values[dim]; v++) {
+			iops = mbps = 0;
+			n = 0;
+			for (k = 0; k < no_cells; k++) {
+				if (cells[k].failed || cells[k].idx[dim] != v)
+					continue;
+				iops += cells[k].iops;
+				mbps += cells[k].mbps;
+				n++;
+			}
+			fprintf(fp, "%s{\"value\": \"%s\", \"iops\": %.0f, "
+					"\"mbps\": %.2f}", v ? ", " : "",
+					s->values[dim][v], n ? iops / n : 0,
+					n ? mbps / n : 0);
+		}
+		fprintf(fp, "]%s\n", dim + 1 < DIMS ? "," : "");
+	}
+	fprintf(fp, "  }\n}\n");
+}
+
+int suite_run(const char *suite, const struct job *tmpl, char **paths,
+		int no_paths, unsigned long seconds, int clk_id,
+		const char *json_path)
+{
+	struct suite	s;
+	struct cell	*cells, *c;
+	struct run	r;
+	FILE		*fp;
+	int		no_cells;
+	int		dim, i, n;
+	int		rc;
+
+	memset(&s, 0, sizeof(s));
+	if (!strcmp(suite, "standard") ? suite_standard(&s) < 0 :
+			suite_parse(&s, suite) < 0) {
+		fprintf(stderr, "Invalid suite %s.\n", suite);
+		return 1;
+	}
+	if (seconds)
+		s.runtime = seconds;
+
+	no_cells = 1;
+	for (dim = 0; dim < DIMS; dim++)
+		no_cells *= s.no_values[dim];
+
+	cells = calloc(no_cells, sizeof(*cells));
+	memset(&r, 0, sizeof(r));
+	r.jobs    = calloc(no_paths, sizeof(*r.jobs));
+	r.no_jobs = no_paths;
+	r.seconds = s.runtime;
+	r.clk_id  = clk_id;
+	r.quiet   = 1;
+	if (!cells || !r.jobs) {
+		fprintf(stderr, "Memory Allocation Failed.\n");
+		return 1;
+	}
+
+	if (s.precondition && suite_precondition(tmpl, paths, no_paths,
+				clk_id) < 0) {
+		fprintf(stderr, "Preconditioning failed.\n");
+		return 1;
+	}
+
+	printf("Running %d combinations for %lu seconds each\n\n", no_cells,
+			s.runtime);
+	printf("%-8s %10s %-10s %7s %12s %10s %12s %12s\n", "engine", "bs",
+			"pattern", "workers", "IOPS", "MB/s", "lat avg ns",
+			"lat p99 ns");
+	fflush(stdout);
+
+	for (i = 0; i < no_cells; i++) {
+		c = &cells[i];
+
+		/* the last dimension changes fastest */
+		n = i;
+		for (dim = DIMS - 1; dim >= 0; dim--) {
+			c->idx[dim] = n % s.no_values[dim];
+			n /= s.no_values[dim];
+		}
+
+		for (n = 0; n < no_paths; n++) {
+			r.jobs[n] = *tmpl;
+			snprintf(r.jobs[n].path, sizeof(r.jobs[n].path), "%s",
+					paths[n]);
+			snprintf(r.jobs[n].name, sizeof(r.jobs[n].name), "%s",
+					paths[n]);
+			r.jobs[n].iterations = 0;
+			if (suite_job(&s, c, &r.jobs[n]) < 0)
+				c->failed = 1;
+		}
+
+		if (!c->failed && suite_one(&r) < 0)
+			c->failed = 1;
+		if (!c->failed)
+			suite_cell_stats(&r, c);
+		run_free(&r);
+
+		printf("%-8s %10s %-10s %7s ", s.values[DIM_ENGINE][c->idx[DIM_ENGINE]],
+				s.values[DIM_BLOCK_SIZE][c->idx[DIM_BLOCK_SIZE]],
+				s.values[DIM_PATTERN][c->idx[DIM_PATTERN]],
+				s.values[DIM_WORKERS][c->idx[DIM_WORKERS]]);
+		if (c->failed)
+			printf("%12s\n", "failed");
+		else
+			printf("%12.0f %10.2f %12llu %12llu\n", c->iops, c->mbps,
+					c->lat_avg, c->lat_p99);
+		fflush(stdout);
+	}
+
+	rc = 0;
+	if (json_path) {
+		fp = strcmp(json_path, "-") ? fopen(json_path, "w") : stdout;
+		if (!fp) {
+			fprintf(stderr, "open(%s) failed: %s\n", json_path,
+					strerror(errno));
+			rc = 1;
+		} else {
+			suite_json(fp, &s, cells, no_cells);
+			if (fp != stdout)
+				fclose(fp);
+		}
+	}
+
+	free(cells);
+	free(r.jobs);
+	return rc;
+}
@@ -31,20 +31,17 @@
 #include <stdio.h>
 #include "ioengine.h"
 
-static int read_block(int fd, void *buf, unsigned long block,
-		unsigned long block_size)
+static int read_at(int fd, void *buf, unsigned long long offset,
+		unsigned long length)
 {
 	char		*b;
-	off64_t		offset;
 	unsigned long	remaining;
 	ssize_t		rc;
 
 	b		= buf;
-	offset		= block * block_size;
-	remaining	= block_size;
+	remaining	= length;
 
-	offset		= lseek64(fd, offset, SEEK_SET);
-	if (offset < 0) {
+	if (lseek64(fd, offset, SEEK_SET) < 0) {
 		fprintf(stderr, "lseek failed: %s\n", strerror(errno));
 		return -1;
 	}
@@ -65,20 +62,17 @@ static int read_block(int fd, void *buf, unsigned long block,
 	return 0;
 }
 
-static int write_block(int fd, void *buf, unsigned long block,
-		unsigned long block_size)
+static int write_at(int fd, void *buf, unsigned long long offset,
+		unsigned long length)
 {
 	char		*b;
-	off64_t		offset;
 	unsigned long	remaining;
 	ssize_t		rc;
 
 	b		= buf;
-	offset		= block * block_size;
-	remaining	= block_size;
+	remaining	= length;
 
-	offset		= lseek64(fd, offset, SEEK_SET);
-	if (offset < 0) {
+	if (lseek64(fd, offset, SEEK_SET) < 0) {
 		fprintf(stderr, "lseek failed: %s\n", strerror(errno));
 		return -1;
 	}
@@ -99,8 +93,24 @@ static int write_block(int fd, void *buf, unsigned long block,
 	return 0;
 }
 
+static int read_block(int fd, void *buf, unsigned long block,
+		unsigned long block_size)
+{
+	return read_at(fd, buf, (unsigned long long) block * block_size,
+			block_size);
+}
+
+static int write_block(int fd, void *buf, unsigned long block,
+		unsigned long block_size)
+{
+	return write_at(fd, buf, (unsigned long long) block * block_size,
+			block_size);
+}
+
 struct ioengine sync_engine = {
 	.name		= "sync",
 	.read_block	= read_block,
 	.write_block	= write_block,
+	.read_at	= read_at,
+	.write_at	= write_at,
 };
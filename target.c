@@ -0,0 +1,124 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+
+#include "iob.h"
+#include "target.h"
+
+#define SECTOR_SIZE	512
+
+/*
+ * Block devices report their geometry through ioctls. Regular files have
+ * no size limit and take any alignment unless opened O_DIRECT, where the
+ * sector size is assumed.
+ */
+int geometry_probe(const char *path, struct geometry *g)
+{
+	struct stat	buf;
+	unsigned int	v;
+	int		fd;
+
+	memset(g, 0, sizeof(*g));
+	if (stat(path, &buf) < 0) {
+		fprintf(stderr, "stat(%s) failed: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	if (!S_ISBLK(buf.st_mode)) {
+		g->capacity = S_ISREG(buf.st_mode) ? buf.st_size : 0;
+		g->logical  = SECTOR_SIZE;
+		g->physical = buf.st_blksize;
+		return 0;
+	}
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "open(%s) failed: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	if (ioctl(fd, BLKGETSIZE64, &g->capacity) < 0) {
+		fprintf(stderr, "ioctl(BLKGETSIZE64) failed: %s\n", strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	g->logical = SECTOR_SIZE;
+	if (!ioctl(fd, BLKSSZGET, &v))
+		g->logical = v;
+
+	g->physical = g->logical;
+	if (!ioctl(fd, BLKPBSZGET, &v))
+		g->physical = v;
+
+	if (!ioctl(fd, BLKIOOPT, &v))
+		g->optimal = v;
+
+	close(fd);
+	return 0;
+}
+
+int job_stripe_width(const struct job *job)
+{
+	const char	*s;
+	int		n;
+
+	if (!job->stripe_chunk)
+		return 1;
+
+	for (n = 1, s = job->path; (s = strchr(s, STRIPE_SEPARATOR)); s++)
+		n++;
+	return n;
+}
+
+/* copies the path of the member'th device of a striped job */
+int job_stripe_path(const struct job *job, int member, char *buf, size_t len)
+{
+	const char	*s, *e;
+	size_t		n;
+
+	s = job->path;
+	while (job->stripe_chunk && member--) {
+		s = strchr(s, STRIPE_SEPARATOR);
+		if (!s)
+			return -1;
+		s++;
+	}
+
+	e = job->stripe_chunk ? strchr(s, STRIPE_SEPARATOR) : NULL;
+	n = e ? e - s : strlen(s);
+	if (n >= len)
+		return -1;
+
+	memcpy(buf, s, n);
+	buf[n] = 0;
+	return 0;
+}
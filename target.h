@@ -0,0 +1,58 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __TARGET_H__
+#define __TARGET_H__
+
+#include <stddef.h>
+
+struct job;
+
+/* what a path can hold and the IO sizes it prefers */
+struct geometry {
+	unsigned long long	capacity;	/* bytes, 0: unknown */
+	unsigned int		logical;	/* smallest addressable unit */
+	unsigned int		physical;	/* smaller writes read-modify-write */
+	unsigned int		optimal;	/* 0: not reported */
+};
+
+/* striped jobs name their member paths separated by this */
+#define STRIPE_SEPARATOR	','
+
+int geometry_probe(const char *path, struct geometry *g);
+
+int job_stripe_width(const struct job *job);
+
+int job_stripe_path(const struct job *job, int member, char *buf, size_t len);
+
+/* member and member block of the logical block of a striped job */
+static inline int stripe_map(unsigned long block, unsigned long chunk_blocks,
+		int width, unsigned long *member_block)
+{
+	unsigned long stripe = block / chunk_blocks;
+
+	*member_block = stripe / width * chunk_blocks + block % chunk_blocks;
+	return stripe % width;
+}
+
+#endif
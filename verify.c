@@ -0,0 +1,201 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <unistd.h>
+
+#include "iob.h"
+#include "verify.h"
+
+/* xorshift64*, cheap enough to refill the buffer for every write */
+void verify_fill(char *buf, unsigned long size, uint64_t seed)
+{
+	uint64_t	*p = (uint64_t *) buf;
+	uint64_t	x  = seed | 1;
+	unsigned long	i;
+
+	for (i = 0; i < size / sizeof(*p); i++) {
+		x ^= x >> 12;
+		x ^= x << 25;
+		x ^= x >> 27;
+		p[i] = x * 0x2545F4914F6CDD1DULL;
+	}
+}
+
+static int verify_one(struct verifier *v, struct verify_rec *rec,
+		char *rb, char *eb)
+{
+	uint64_t	*gen = &v->gen[rec->block - v->start_block];
+	off_t		offset = (off_t) rec->block * v->block_size;
+	ssize_t		rc;
+
+	if (__atomic_load_n(gen, __ATOMIC_ACQUIRE) != rec->seed)
+		return 1;
+
+	/* engines keep per process state, read with pread() */
+	rc = pread(v->fd, rb, v->block_size, offset);
+	if (rc != v->block_size) {
+		fprintf(stderr, "Verify read of block %lu failed.\n", rec->block);
+		return -1;
+	}
+
+	/* a write with a new seed may have raced with the read */
+	if (__atomic_load_n(gen, __ATOMIC_ACQUIRE) != rec->seed)
+		return 1;
+
+	verify_fill(eb, v->block_size, rec->seed);
+	if (memcmp(rb, eb, v->block_size)) {
+		fprintf(stderr, "Possible Data Corruption at block %lu\n",
+				rec->block);
+		return -1;
+	}
+	return 0;
+}
+
+static void *verifier_thread(void *arg)
+{
+	struct verifier		*v = arg;
+	struct verify_rec	rec;
+	char			*rb, *eb;
+	int			rc;
+
+	rb = memalign(IO_BLOCK_SIZE, v->block_size);
+	eb = memalign(IO_BLOCK_SIZE, v->block_size);
+	if (!rb || !eb) {
+		free(rb);
+		free(eb);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&v->lock);
+	for (;;) {
+		while (!v->count && !v->done)
+			pthread_cond_wait(&v->cond, &v->lock);
+		if (!v->count)
+			break;
+
+		rec = v->q[v->head];
+		v->head = (v->head + 1) % v->size;
+		v->count--;
+		pthread_mutex_unlock(&v->lock);
+
+		rc = verify_one(v, &rec, rb, eb);
+
+		pthread_mutex_lock(&v->lock);
+		if (rc > 0) {
+			v->stats->superseded++;
+		} else if (rc < 0) {
+			v->stats->mismatches++;
+		} else {
+			v->stats->verified++;
+			lat_hist_add(&v->stats->lag,
+					get_hrtime(v->clk_id) - rec.ns);
+		}
+	}
+	pthread_mutex_unlock(&v->lock);
+
+	free(rb);
+	free(eb);
+	return NULL;
+}
+
+int verifier_start(struct verifier *v, int fd, unsigned long start_block,
+		unsigned long blocks, unsigned long block_size, int threads,
+		unsigned int queue, int clk_id, struct verify_stats *stats)
+{
+	int	i;
+
+	memset(v, 0, sizeof(*v));
+	v->fd          = fd;
+	v->start_block = start_block;
+	v->block_size  = block_size;
+	v->clk_id      = clk_id;
+	v->stats       = stats;
+	v->size        = queue ? queue : VERIFY_QUEUE_SIZE;
+	v->q           = calloc(v->size, sizeof(*v->q));
+	v->gen         = calloc(blocks, sizeof(*v->gen));
+	v->threads     = calloc(threads, sizeof(*v->threads));
+	if (!v->q || !v->gen || !v->threads) {
+		fprintf(stderr, "Memory Allocation Failed.\n");
+		return -1;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+	lat_hist_init(&stats->lag);
+	pthread_mutex_init(&v->lock, NULL);
+	pthread_cond_init(&v->cond, NULL);
+
+	for (i = 0; i < threads; i++) {
+		if (pthread_create(&v->threads[i], NULL, verifier_thread, v)) {
+			fprintf(stderr, "Starting verifier thread failed.\n");
+			verifier_stop(v);
+			return -1;
+		}
+		v->no_threads++;
+	}
+	return 0;
+}
+
+/* never blocks the writer, records that do not fit are dropped */
+void verifier_queue(struct verifier *v, unsigned long block, uint64_t seed,
+		unsigned long long ns)
+{
+	struct verify_rec *rec;
+
+	pthread_mutex_lock(&v->lock);
+	if (v->count == v->size) {
+		v->stats->dropped++;
+	} else {
+		rec = &v->q[(v->head + v->count) % v->size];
+		rec->block = block;
+		rec->seed  = seed;
+		rec->ns    = ns;
+		v->count++;
+		pthread_cond_signal(&v->cond);
+	}
+	pthread_mutex_unlock(&v->lock);
+}
+
+/* drains the queue, returns -1 if any block did not verify */
+int verifier_stop(struct verifier *v)
+{
+	int	i;
+
+	pthread_mutex_lock(&v->lock);
+	v->done = 1;
+	pthread_cond_broadcast(&v->cond);
+	pthread_mutex_unlock(&v->lock);
+
+	for (i = 0; i < v->no_threads; i++)
+		pthread_join(v->threads[i], NULL);
+
+	free(v->q);
+	free(v->gen);
+	free(v->threads);
+	return v->stats->mismatches ? -1 : 0;
+}
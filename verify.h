@@ -0,0 +1,96 @@
+/*
+ * iob -- IO Benchmarking Tool
+ *
+ * Copyright (C) 2013 Prasad Joshi <prasadjoshi.linux@gmail.com>
+ *
+ * The license below covers all files distributed with fio unless otherwise
+ * noted in the file itself.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __VERIFY_H__
+#define __VERIFY_H__
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "stats.h"
+
+#define VERIFY_THREADS		1
+#define VERIFY_QUEUE_SIZE	1024
+
+/* counters of the background verifiers of one worker */
+struct verify_stats {
+	unsigned long long	verified;
+	unsigned long long	superseded;	/* rewritten before verified */
+	unsigned long long	dropped;	/* queue was full */
+	unsigned long long	mismatches;
+	struct lat_hist		lag;		/* write done to verified, ns */
+};
+
+struct verify_rec {
+	unsigned long		block;
+	uint64_t		seed;
+	unsigned long long	ns;		/* write completion */
+};
+
+/*
+ * Verifier threads of one worker. The writer queues a record for every
+ * block it wrote and keeps going; a verifier regenerates the expected
+ * content from the seed and compares it with a read of the block. gen
+ * holds the seed last written to each block, records of blocks that have
+ * been written again since are skipped.
+ */
+struct verifier {
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;
+	struct verify_rec	*q;
+	unsigned int		size;
+	unsigned int		head;		/* next record to verify */
+	unsigned int		count;
+	int			done;
+
+	pthread_t		*threads;
+	int			no_threads;
+
+	int			fd;
+	unsigned long		start_block;
+	unsigned long		block_size;
+	uint64_t		*gen;		/* by block - start_block */
+	int			clk_id;
+	struct verify_stats	*stats;		/* updated under lock */
+};
+
+void verify_fill(char *buf, unsigned long size, uint64_t seed);
+
+int verifier_start(struct verifier *v, int fd, unsigned long start_block,
+		unsigned long blocks, unsigned long block_size, int threads,
+		unsigned int queue, int clk_id, struct verify_stats *stats);
+
+/* to be called before the block is written with seed */
+static inline void verifier_writing(struct verifier *v, unsigned long block,
+		uint64_t seed)
+{
+	__atomic_store_n(&v->gen[block - v->start_block], seed,
+			__ATOMIC_RELEASE);
+}
+
+void verifier_queue(struct verifier *v, unsigned long block, uint64_t seed,
+		unsigned long long ns);
+
+int verifier_stop(struct verifier *v);
+
+#endif